@@ -11,9 +11,6 @@
 #define PIT_PORT_CONTROL          0x43                /* Control port. */
 #define PIT_PORT_COUNTER(CHANNEL) (0x40 + (CHANNEL))  /* Counter port. */
 
-/* PIT cycles per second. */
-#define PIT_HZ 1193180
-
 /* Configure the given CHANNEL in the PIT.  In a PC, the PIT's
    three output channels are hooked up like this:
 
@@ -39,6 +36,9 @@
        it is 1, for the second half it is 0.  This is useful for
        generating a tone on a speaker.
 
+     - Mode 0 raises the output once, when a count runs out.
+       pit_start_oneshot() uses it for tickless idle.
+
      - Other modes are less useful.
 
    FREQUENCY is the number of periods per second, in Hz. */
@@ -81,3 +81,44 @@ pit_configure_channel (int channel, int mode, int frequency)
   outb (PIT_PORT_COUNTER (channel), count >> 8);
   intr_set_level (old_level);
 }
+
+/* Starts CHANNEL counting down from COUNT PIT cycles in mode 0,
+   "interrupt on terminal count": the channel's output goes to 1,
+   raising an interrupt on channel 0, once, when the count reaches
+   0.  The counter then keeps counting down from 65535, so that a
+   count read back that is above COUNT means it has expired.
+   COUNT must be nonzero. */
+void
+pit_start_oneshot (int channel, uint16_t count)
+{
+  enum intr_level old_level;
+
+  ASSERT (channel == 0 || channel == 2);
+  ASSERT (count != 0);
+
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, (channel << 6) | 0x30);
+  outb (PIT_PORT_COUNTER (channel), count);
+  outb (PIT_PORT_COUNTER (channel), count >> 8);
+  intr_set_level (old_level);
+}
+
+/* Returns the current value of CHANNEL's counter, in PIT cycles
+   left in the current period or one-shot interval. */
+uint16_t
+pit_read_count (int channel)
+{
+  enum intr_level old_level;
+  uint8_t low, high;
+
+  ASSERT (channel == 0 || channel == 2);
+
+  /* Latch the counter, then read it back, low byte first. */
+  old_level = intr_disable ();
+  outb (PIT_PORT_CONTROL, channel << 6);
+  low = inb (PIT_PORT_COUNTER (channel));
+  high = inb (PIT_PORT_COUNTER (channel));
+  intr_set_level (old_level);
+
+  return low | (high << 8);
+}
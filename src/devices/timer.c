@@ -17,8 +17,37 @@
 #error TIMER_FREQ <= 1000 recommended
 #endif
 
-/* Number of timer ticks since OS booted. */
+/* Number of timer ticks since OS booted.  Written only by the
+   timer interrupt, and by the idle thread with interrupts off. */
 static int64_t ticks;
+static struct seqlock ticks_seqlock;
+
+/* Sleeping threads, kept in a hashed timing wheel.  A thread that
+   wakes at tick T sits in slot T % TIMER_WHEEL_SIZE, so going to
+   sleep and waking up are O(1) and each timer interrupt only looks
+   at one slot.  Threads that sleep for more than one turn of the
+   wheel stay in their slot until the turn in which they are due. */
+#define TIMER_WHEEL_SIZE 256
+static struct list timer_wheel[TIMER_WHEEL_SIZE];
+
+/* If true, the idle thread stops the periodic timer interrupt
+   and programs the PIT to fire only at the next wake-up time, or
+   as late as the 16-bit counter allows.  Controlled by kernel
+   command-line option "-tickless". */
+bool timer_tickless;
+
+/* PIT cycles in one timer tick, and the most ticks that fit in a
+   one-shot count. */
+#define PIT_TICK_CYCLES ((PIT_HZ + TIMER_FREQ / 2) / TIMER_FREQ)
+#define TICKLESS_MAX_TICKS (UINT16_MAX / PIT_TICK_CYCLES)
+
+/* One-shot interval in progress, if any. */
+static int64_t oneshot_ticks;      /* Ticks covered, 0 if periodic. */
+static uint16_t oneshot_count;     /* PIT cycles programmed. */
+
+/* Statistics. */
+static long long tickless_intervals;    /* # of one-shot intervals. */
+static long long tickless_skipped;      /* Ticks without an interrupt. */
 
 /* Number of loops per timer tick.
    Initialized by timer_calibrate(). */
@@ -29,11 +58,19 @@ static bool too_many_loops(unsigned loops);
 static void busy_wait(int64_t loops);
 static void real_time_sleep(int64_t num, int32_t denom);
 static void real_time_delay(int64_t num, int32_t denom);
+static void wake_sleepers(void);
+static bool sleepers_due(int64_t tick);
+static void tickless_catch_up(void);
 
 /* Sets up the timer to interrupt TIMER_FREQ times per second,
    and registers the corresponding interrupt. */
 void timer_init(void)
 {
+  int i;
+
+  for (i = 0; i < TIMER_WHEEL_SIZE; i++)
+    list_init(&timer_wheel[i]);
+  seqlock_init(&ticks_seqlock);
   pit_configure_channel(0, 2, TIMER_FREQ);
   intr_register_ext(0x20, timer_interrupt, "8254 Timer");
 }
@@ -68,9 +105,16 @@ void timer_calibrate(void)
 int64_t
 timer_ticks(void)
 {
-  enum intr_level old_level = intr_disable();
-  int64_t t = ticks;
-  intr_set_level(old_level);
+  unsigned start;
+  int64_t t;
+
+  /* A 64-bit load takes two instructions, so a timer interrupt
+     in between would tear it. */
+  do
+  {
+    start = seqlock_read_begin(&ticks_seqlock);
+    t = ticks;
+  } while (seqlock_read_retry(&ticks_seqlock, start));
   return t;
 }
 
@@ -82,19 +126,6 @@ timer_elapsed(int64_t then)
   return timer_ticks() - then;
 }
 
-bool cmp_wake_time (const struct list_elem *a,
-		const struct list_elem *b,
-		void *aux UNUSED)
-{
-  struct thread *ta = list_entry(a, struct thread, elem);
-  struct thread *tb = list_entry(b, struct thread, elem);
-  if (ta->wake_time < tb->wake_time)
-    {
-      return true;
-    }
-  return false;
-}
-
 /* Sleeps for approximately TICKS timer ticks.  Interrupts must
    be turned on. 
    Fix busy waiting */
@@ -106,9 +137,10 @@ void timer_sleep(int64_t ticks)
     return;
   }
   enum intr_level old_level = intr_disable();
-  thread_current()->wake_time = timer_ticks() + ticks;
-  list_insert_ordered(&sleep_list, &thread_current()->elem,
-                      (list_less_func *)&cmp_wake_time, NULL);
+  struct thread *cur = thread_current();
+  cur->wake_time = timer_ticks() + ticks;
+  list_push_back(&timer_wheel[cur->wake_time % TIMER_WHEEL_SIZE],
+                 &cur->sleep_elem);
   thread_block();
   intr_set_level(old_level);
 }
@@ -174,27 +206,125 @@ void timer_ndelay(int64_t ns)
 void timer_print_stats(void)
 {
   printf("Timer: %" PRId64 " ticks\n", timer_ticks());
+  if (timer_tickless)
+    printf("Tickless: %lld idle ticks skipped in %lld intervals\n",
+           tickless_skipped, tickless_intervals);
+}
+
+/* Called by the idle thread, with interrupts off, just before it
+   halts.  Unless a sleeping thread is due at the next tick,
+   replaces the periodic timer interrupt by a single one at the
+   next wake-up time, so that an idle CPU is not woken up every
+   tick.  The multi-level feedback queue scheduler needs to see
+   every tick, so this does nothing under it. */
+void timer_idle_enter(void)
+{
+  int64_t n;
+
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (!timer_tickless || thread_mlfqs || oneshot_ticks != 0)
+    return;
+
+  for (n = 1; n < TICKLESS_MAX_TICKS; n++)
+    if (sleepers_due(ticks + n))
+      break;
+  if (n == 1)
+    return;
+
+  oneshot_ticks = n;
+  oneshot_count = n * PIT_TICK_CYCLES;
+  pit_start_oneshot(0, oneshot_count);
+  tickless_intervals++;
+}
+
+/* Called with interrupts off when the idle thread gives up the
+   CPU.  If a one-shot interval is in progress, accounts for the
+   ticks that have passed in it and goes back to the periodic
+   timer interrupt. */
+void timer_idle_exit(void)
+{
+  ASSERT(intr_get_level() == INTR_OFF);
+  if (oneshot_ticks != 0)
+    tickless_catch_up();
 }
 
 /* Timer interrupt handler. */
 static void
 timer_interrupt(struct intr_frame *args UNUSED)
 {
+  if (oneshot_ticks != 0)
+    tickless_catch_up();
+
+  enum intr_level old_level = seqlock_write_begin(&ticks_seqlock);
   ticks++;
+  seqlock_write_end(&ticks_seqlock, old_level);
   thread_tick();
+  wake_sleepers();
+}
+
+/* Ends the one-shot interval in progress.  Advances the tick
+   count by the whole ticks that have passed since it started,
+   charging them to the idle thread and waking any sleepers that
+   became due, and restarts the periodic interrupt.  If the
+   interval ran out, its last tick is left to the timer interrupt
+   that signals it, which is either the caller or still pending.
+
+   The fraction of a tick that passed before an early exit is
+   lost, so the tick count runs slightly slow while idle. */
+static void
+tickless_catch_up(void)
+{
+  uint16_t left = pit_read_count(0);
+  int64_t passed;
+
+  if (left == 0 || left > oneshot_count)
+    passed = oneshot_ticks - 1;
+  else
+    passed = (oneshot_count - left) / PIT_TICK_CYCLES;
+
+  oneshot_ticks = 0;
+  pit_configure_channel(0, 2, TIMER_FREQ);
+
+  tickless_skipped += passed;
+  thread_add_idle_ticks(passed);
+  while (passed-- > 0)
+  {
+    enum intr_level old_level = seqlock_write_begin(&ticks_seqlock);
+    ticks++;
+    seqlock_write_end(&ticks_seqlock, old_level);
+    wake_sleepers();
+  }
+}
+
+/* Returns true if a sleeping thread is due at tick TICK. */
+static bool
+sleepers_due(int64_t tick)
+{
+  struct list *slot = &timer_wheel[tick % TIMER_WHEEL_SIZE];
+  struct list_elem *e;
+
+  for (e = list_begin(slot); e != list_end(slot); e = list_next(e))
+    if (list_entry(e, struct thread, sleep_elem)->wake_time <= tick)
+      return true;
+  return false;
+}
 
-  // wake up sleeping thread
-  struct list_elem *e = list_begin(&sleep_list);
-  while (e != list_end(&sleep_list))
+/* Wakes up the sleeping threads that are due at the current
+   tick. */
+static void
+wake_sleepers(void)
+{
+  struct list *slot = &timer_wheel[ticks % TIMER_WHEEL_SIZE];
+  struct list_elem *e = list_begin(slot);
+  while (e != list_end(slot))
   {
-    struct thread *t = list_entry(e, struct thread, elem);
-    if (ticks < t->wake_time)
+    struct thread *t = list_entry(e, struct thread, sleep_elem);
+    e = list_next(e);
+    if (t->wake_time <= ticks)
     {
-      break;
+      list_remove(&t->sleep_elem);
+      thread_unblock(t);
     }
-    list_remove(e);
-    thread_unblock(t);
-    e = list_begin(&sleep_list);
   }
 }
 
@@ -0,0 +1,31 @@
+/* lockstat.c
+
+   Prints the kernel's lock contention statistics.  The kernel
+   only gathers them when booted with "-lockprof". */
+
+#include <stdio.h>
+#include <syscall.h>
+
+int
+main (void) 
+{
+  struct lock_stat stat;
+  int i, b;
+
+  for (i = 0; lock_stat (i, &stat); i++)
+    {
+      printf ("%-16s %8u acquired %8u contended "
+              "wait %u (max %u) hold %u (max %u)\n",
+              stat.name, stat.acquired, stat.contended,
+              stat.wait_ticks, stat.max_wait_ticks,
+              stat.hold_ticks, stat.max_hold_ticks);
+      printf ("%-16s wait histogram:", "");
+      for (b = 0; b < LOCK_STAT_BUCKETS; b++)
+        printf (" %u", stat.wait_hist[b]);
+      printf ("\n");
+    }
+  if (i == 0)
+    printf ("no profiled locks\n");
+  
+  return EXIT_SUCCESS;
+}
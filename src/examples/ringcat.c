@@ -0,0 +1,105 @@
+/* ringcat.c
+
+   Prints files specified on command line to the console, like
+   cat, but queues its opens, reads, writes and closes on a
+   submission ring so that each batch of them costs one system
+   call. */
+
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+
+#define MAX_FILES 16            /* Files opened in one batch. */
+#define BATCH 8                 /* Blocks read in one batch. */
+#define BLOCK_SIZE 512          /* Bytes per read. */
+
+static struct ring ring;
+static char blocks[BATCH][BLOCK_SIZE];
+
+/* Queues an operation on the ring. */
+static void
+queue (int op, int fd, void *buf, unsigned len, int offset,
+       unsigned user_data)
+{
+  struct ring_sqe *sqe = &ring.sq[ring.sq_tail % RING_ENTRIES];
+
+  sqe->op = op;
+  sqe->fd = fd;
+  sqe->buf = buf;
+  sqe->len = len;
+  sqe->offset = offset;
+  sqe->user_data = user_data;
+  ring.sq_tail++;
+}
+
+/* Runs everything queued and takes the completions into
+   RESULTS, indexed by user_data. */
+static void
+submit (int results[])
+{
+  ring_enter (&ring, ring.sq_tail - ring.sq_head);
+  while (ring.cq_head != ring.cq_tail)
+    {
+      struct ring_cqe *cqe = &ring.cq[ring.cq_head++ % RING_ENTRIES];
+      results[cqe->user_data] = cqe->result;
+    }
+}
+
+int
+main (int argc, char *argv[]) 
+{
+  int fds[MAX_FILES];
+  int got[BATCH];
+  bool success = true;
+  int file_cnt = argc - 1 < MAX_FILES ? argc - 1 : MAX_FILES;
+  int i, b;
+
+  if (argc - 1 > MAX_FILES)
+    {
+      printf ("ringcat: only the first %d files are printed\n", MAX_FILES);
+      success = false;
+    }
+
+  /* Open every file at once. */
+  for (i = 0; i < file_cnt; i++)
+    queue (RING_OP_OPEN, 0, argv[i + 1], strlen (argv[i + 1]) + 1, 0, i);
+  submit (fds);
+
+  for (i = 0; i < file_cnt; i++) 
+    {
+      int ofs = 0;
+      bool eof = false;
+
+      if (fds[i] < 0) 
+        {
+          printf ("%s: open failed\n", argv[i + 1]);
+          success = false;
+          continue;
+        }
+      while (!eof)
+        {
+          /* Read the next BATCH blocks, then print them. */
+          for (b = 0; b < BATCH; b++)
+            queue (RING_OP_READ, fds[i], blocks[b], BLOCK_SIZE,
+                   ofs + b * BLOCK_SIZE, b);
+          submit (got);
+          for (b = 0; b < BATCH && !eof; b++)
+            {
+              if (got[b] > 0)
+                queue (RING_OP_WRITE, STDOUT_FILENO, blocks[b], got[b],
+                       -1, b);
+              eof = got[b] < BLOCK_SIZE;
+            }
+          submit (got);
+          ofs += BATCH * BLOCK_SIZE;
+        }
+    }
+
+  /* Close them all at once too. */
+  for (i = 0; i < file_cnt; i++)
+    if (fds[i] >= 0)
+      queue (RING_OP_CLOSE, fds[i], NULL, 0, 0, i);
+  submit (fds);
+
+  return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -1,7 +1,43 @@
 #include "filesys/cache.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/thread.h"
+#include "threads/vaddr.h"
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+
+/* Object cache for cache entries, which are too big to fit
+   malloc()'s size classes well. */
+static struct kmem_cache *cache_entry_cache;
+
+/* Sectors waiting for the read-ahead thread, a ring buffer
+   protected by filesys_cache_lock. */
+static block_sector_t read_ahead_queue[READ_AHEAD_QUEUE_SIZE];
+static size_t read_ahead_head;                  /* next request to serve */
+static size_t read_ahead_cnt;                   /* number of requests queued */
+static struct condition read_ahead_cond;        /* signaled on new request */
+
+/* Statistics. */
+static long long cache_hits;            /* lookups found in the cache */
+static long long cache_misses;          /* lookups that read the disk */
+static long long read_ahead_reads;      /* sectors read by read-ahead */
+static long long read_ahead_hits;       /* ...later used, a miss avoided */
+static long long shrunk_entries;        /* entries evicted by the shrinker */
+
+/* Number of delayed entries, which hold data appended to a file
+   before it has a sector to go to.  They can be neither evicted
+   nor written back, so only DELAYED_CACHE_MAX of them may exist,
+   leaving room for the rest of the cache to work. */
+static size_t delayed_cnt;
+
+static size_t filesys_cache_shrink (size_t page_cnt);
+static void write_back (struct cache_entry *c);
+static struct cache_entry *cache_install (block_sector_t sector, bool dirty,
+                                          bool read);
 
 /* Initialize the cache , create a always-runnnin process
    to write the dirty cache back every 5 TIME FREQUENCY
@@ -10,8 +46,19 @@ void filesys_cache_init(void)
 {
   list_init(&filesys_cache);
   lock_init(&filesys_cache_lock);
+  lock_set_name(&filesys_cache_lock, "filesys_cache");
+  cache_entry_cache = kmem_cache_create("cache_entry",
+                                        sizeof(struct cache_entry), NULL);
+  if (cache_entry_cache == NULL)
+    PANIC("can't create cache entry object cache");
   filesys_cache_size = 0;
-  thread_create("filesys_cache_writeback", 0, write_cache_back_loop, NULL);
+  palloc_register_shrinker(filesys_cache_shrink);
+  cond_init(&read_ahead_cond);
+  read_ahead_head = read_ahead_cnt = 0;
+  thread_create("filesys_cache_writeback", PRI_DEFAULT,
+                write_cache_back_loop, NULL);
+  thread_create("filesys_cache_read_ahead", PRI_DEFAULT,
+                thread_func_read_ahead, NULL);
 }
 
 /**  
@@ -52,9 +99,16 @@ struct cache_entry *filesys_cache_get_block(block_sector_t sector,
     c->open_cnt++;
     c->dirty |= dirty;
     c->ref_bit = true;
+    cache_hits++;
+    if (c->prefetched)
+    {
+      c->prefetched = false;
+      read_ahead_hits++;
+    }
     lock_release(&filesys_cache_lock);
     return c;
   }
+  cache_misses++;
   c = cache_replace(sector, dirty);
   if (!c)
   {
@@ -72,28 +126,43 @@ struct cache_entry *filesys_cache_get_block(block_sector_t sector,
 struct cache_entry *cache_replace(block_sector_t sector,
                                               bool dirty)
 {
-  struct cache_entry *c;
-  if (filesys_cache_size < MAX_FILESYS_CACHE_SIZE)
+  return cache_install(sector, dirty, true);
+}
+
+/* Does the work of cache_replace(), reading SECTOR from disk into
+   the entry only if READ is true. */
+static struct cache_entry *cache_install(block_sector_t sector, bool dirty,
+                                         bool read)
+{
+  struct cache_entry *c = NULL;
+  /* grow up to the usual size, and past it while memory is idle;
+     the shrinker takes the extra entries back under pressure */
+  if (filesys_cache_size < MAX_FILESYS_CACHE_SIZE || palloc_memory_idle())
+    c = kmem_cache_alloc(cache_entry_cache);
+  if (c)
   {
     /* create a new cache */
     filesys_cache_size++;
-    c = malloc(sizeof(struct cache_entry));
-    if (!c)
-    {
-      return NULL;
-    }
     c->open_cnt = 0;
     list_push_back(&filesys_cache, &c->elem);
   }
-  else // find a cache to replace
+  else if (filesys_cache_size > 0) // find a cache to replace
   {
     c = find_replace();
   }
+  else
+  {
+    return NULL;
+  }
   c->open_cnt++;
   c->sector = sector;
-  block_read(fs_device, c->sector, &c->block);
+  if (read)
+    block_read(fs_device, c->sector, &c->block);
   c->dirty = dirty;
   c->ref_bit = true;
+  c->prefetched = false;
+  c->owner = NULL;
+  c->delayed = false;
   return c;
 }
 
@@ -109,7 +178,7 @@ struct cache_entry *find_replace()
          e = list_next(e))
     {
       replace = list_entry(e, struct cache_entry, elem);
-      if (replace->open_cnt == 0)
+      if (replace->open_cnt == 0 && !replace->delayed)
       {
         if (replace->ref_bit)
         {
@@ -119,7 +188,7 @@ struct cache_entry *find_replace()
         {
           if (replace->dirty)
           {
-            block_write(fs_device, replace->sector, &replace->block);
+            write_back(replace);
           }
           return replace;
         }
@@ -140,35 +209,365 @@ void filesys_cache_write_to_disk(bool is_remove)
   {
     next = list_next(e);
     struct cache_entry *c = list_entry(e, struct cache_entry, elem);
-    if (c->dirty)
+    if (c->dirty && !c->delayed)
     {
-      block_write(fs_device, c->sector, &c->block);
-      c->dirty = false;
+      write_back(c);
     }
     if (is_remove)
     {
       list_remove(&c->elem);
-      free(c);
+      kmem_cache_free(cache_entry_cache, c);
+      filesys_cache_size--;
     }
     e = next;
   }
   lock_release(&filesys_cache_lock);
 }
 
-/* execute write back dirty cache every 5 time frequence*/
+/* Writes the dirty entry C back to disk and takes it off its
+   owner's dirty list.  The caller must hold filesys_cache_lock. */
+static void write_back(struct cache_entry *c)
+{
+  block_write(fs_device, c->sector, &c->block);
+  c->dirty = false;
+  if (c->owner)
+  {
+    list_remove(&c->dirty_elem);
+    c->owner = NULL;
+  }
+}
+
+/* Marks C dirty on behalf of a write to INODE and puts it on
+   INODE's list of dirty sectors, for filesys_cache_sync(). */
+void filesys_cache_mark_dirty(struct cache_entry *c, struct inode *inode)
+{
+  lock_acquire(&filesys_cache_lock);
+  c->dirty = true;
+  if (c->owner == NULL)
+  {
+    c->owner = inode;
+    list_push_back(&inode->dirty_sectors, &c->dirty_elem);
+  }
+  lock_release(&filesys_cache_lock);
+}
+
+/* Writes back every entry on DIRTY_SECTORS, an inode's list of
+   dirty sectors, leaving the list empty.  Other dirty entries
+   wait for the write-back thread as usual. */
+void filesys_cache_sync(struct list *dirty_sectors)
+{
+  lock_acquire(&filesys_cache_lock);
+  while (!list_empty(dirty_sectors))
+    write_back(list_entry(list_front(dirty_sectors), struct cache_entry,
+                          dirty_elem));
+  lock_release(&filesys_cache_lock);
+}
+
+/* Empties DIRTY_SECTORS, an inode's list of dirty sectors, before
+   the inode goes away.  The entries stay dirty and are written
+   back later like any other. */
+void filesys_cache_forget(struct list *dirty_sectors)
+{
+  lock_acquire(&filesys_cache_lock);
+  while (!list_empty(dirty_sectors))
+  {
+    struct cache_entry *c = list_entry(list_pop_front(dirty_sectors),
+                                       struct cache_entry, dirty_elem);
+    c->owner = NULL;
+  }
+  lock_release(&filesys_cache_lock);
+}
+
+/* Fills the cached copy of SECTOR, a sector of INODE that has never
+   been written, with zeros, without reading the old contents from
+   disk, and marks it dirty on behalf of INODE. */
+void filesys_cache_zero_block(block_sector_t sector, struct inode *inode)
+{
+  lock_acquire(&filesys_cache_lock);
+  struct cache_entry *c = get_block_in_cache(sector);
+  if (c == NULL)
+  {
+    c = cache_install(sector, true, false);
+    if (c == NULL)
+      PANIC("Not enough memory for buffer cache.");
+    c->open_cnt--;
+  }
+  memset(c->block, 0, BLOCK_SECTOR_SIZE);
+  c->dirty = true;
+  if (c->owner == NULL)
+  {
+    c->owner = inode;
+    list_push_back(&inode->dirty_sectors, &c->dirty_elem);
+  }
+  lock_release(&filesys_cache_lock);
+}
+
+/* Drops the entry C without writing it back.  An entry still in
+   use is only detached from its sector.  The caller must hold
+   filesys_cache_lock. */
+static void discard(struct cache_entry *c)
+{
+  if (c->owner)
+  {
+    list_remove(&c->dirty_elem);
+    c->owner = NULL;
+  }
+  c->dirty = false;
+  if (c->open_cnt == 0)
+  {
+    list_remove(&c->elem);
+    kmem_cache_free(cache_entry_cache, c);
+    filesys_cache_size--;
+  }
+  else
+    c->sector = BLOCK_SECTOR_NONE;
+}
+
+/* Drops the cached copy of SECTOR, which is being freed, without
+   writing it back, so that it can neither overwrite the sector's
+   next user nor be read in its place, and cancels any read-ahead
+   of SECTOR still queued, which would bring the old contents
+   back. */
+void filesys_cache_discard(block_sector_t sector)
+{
+  size_t i, kept = 0;
+
+  lock_acquire(&filesys_cache_lock);
+  struct cache_entry *c = get_block_in_cache(sector);
+  if (c)
+    discard(c);
+  for (i = 0; i < read_ahead_cnt; i++)
+  {
+    block_sector_t queued
+      = read_ahead_queue[(read_ahead_head + i) % READ_AHEAD_QUEUE_SIZE];
+    if (queued != sector)
+      read_ahead_queue[(read_ahead_head + kept++) % READ_AHEAD_QUEUE_SIZE]
+        = queued;
+  }
+  read_ahead_cnt = kept;
+  lock_release(&filesys_cache_lock);
+}
+
+/* Makes C the next entry find_replace() evicts, unless it is used
+   again first, by clearing its reference bit and moving it to the
+   front of the list, where the search starts.  The caller must
+   hold filesys_cache_lock. */
+static void demote(struct cache_entry *c)
+{
+  c->ref_bit = false;
+  list_remove(&c->elem);
+  list_push_front(&filesys_cache, &c->elem);
+}
+
+/* Marks C, which the caller has open, as not needed again soon. */
+void filesys_cache_demote(struct cache_entry *c)
+{
+  lock_acquire(&filesys_cache_lock);
+  demote(c);
+  lock_release(&filesys_cache_lock);
+}
+
+/* Marks the cached copy of SECTOR, if any, as not needed again
+   soon. */
+void filesys_cache_demote_sector(block_sector_t sector)
+{
+  lock_acquire(&filesys_cache_lock);
+  struct cache_entry *c = get_block_in_cache(sector);
+  if (c)
+    demote(c);
+  lock_release(&filesys_cache_lock);
+}
+
+/* Shrinker for the buffer cache, run when memory is short:
+   evicts unused entries, writing back dirty ones, until about
+   PAGE_CNT pages' worth are gone or MIN_FILESYS_CACHE_SIZE
+   entries remain.  Does nothing if the cache lock is busy, which
+   includes the cache itself allocating an entry. */
+static size_t filesys_cache_shrink(size_t page_cnt)
+{
+  size_t per_page = PGSIZE / sizeof(struct cache_entry);
+  size_t evicted = 0;
+  struct list_elem *e, *next;
+
+  if (lock_held_by_current_thread(&filesys_cache_lock)
+      || !lock_try_acquire(&filesys_cache_lock))
+    return 0;
+  for (e = list_begin(&filesys_cache); e != list_end(&filesys_cache);
+       e = next)
+  {
+    struct cache_entry *c = list_entry(e, struct cache_entry, elem);
+    next = list_next(e);
+    if (evicted >= page_cnt * per_page
+        || filesys_cache_size <= MIN_FILESYS_CACHE_SIZE + delayed_cnt)
+      break;
+    if (c->open_cnt == 0 && !c->delayed)
+    {
+      if (c->dirty)
+        write_back(c);
+      list_remove(&c->elem);
+      kmem_cache_free(cache_entry_cache, c);
+      filesys_cache_size--;
+      evicted++;
+    }
+  }
+  shrunk_entries += evicted;
+  lock_release(&filesys_cache_lock);
+  return DIV_ROUND_UP(evicted, per_page);
+}
+
+/* Returns a new delayed entry, all zeros, to hold data appended
+   to a file until filesys_cache_place() gives it a sector.  It
+   stays in the cache until then, or until filesys_cache_drop().
+   Returns a null pointer if there are DELAYED_CACHE_MAX delayed
+   entries already. */
+struct cache_entry *filesys_cache_new_delayed(void)
+{
+  struct cache_entry *c = NULL;
+
+  lock_acquire(&filesys_cache_lock);
+  if (delayed_cnt < DELAYED_CACHE_MAX)
+  {
+    c = cache_install(BLOCK_SECTOR_NONE, true, false);
+    if (c == NULL)
+      PANIC("Not enough memory for buffer cache.");
+    c->open_cnt--;
+    memset(c->block, 0, BLOCK_SECTOR_SIZE);
+    c->delayed = true;
+    delayed_cnt++;
+  }
+  lock_release(&filesys_cache_lock);
+  return c;
+}
+
+/* Gives the delayed entry C its SECTOR, just allocated, making it
+   an ordinary dirty entry of INODE.  Any other entry for SECTOR
+   is a stale copy of its last user's data, which read-ahead may
+   have fetched after it was freed, and is dropped so that C is
+   the only one. */
+void filesys_cache_place(struct cache_entry *c, block_sector_t sector,
+                         struct inode *inode)
+{
+  struct cache_entry *old;
+
+  lock_acquire(&filesys_cache_lock);
+  ASSERT(c->delayed);
+  old = get_block_in_cache(sector);
+  if (old)
+  {
+    ASSERT(!old->dirty);
+    discard(old);
+  }
+  c->sector = sector;
+  c->delayed = false;
+  delayed_cnt--;
+  c->ref_bit = true;
+  if (c->owner == NULL)
+  {
+    c->owner = inode;
+    list_push_back(&inode->dirty_sectors, &c->dirty_elem);
+  }
+  lock_release(&filesys_cache_lock);
+}
+
+/* Throws away the delayed entry C, whose file no longer needs
+   its data, without it ever reaching the disk. */
+void filesys_cache_drop(struct cache_entry *c)
+{
+  lock_acquire(&filesys_cache_lock);
+  ASSERT(c->delayed);
+  c->delayed = false;
+  c->dirty = false;
+  delayed_cnt--;
+  if (c->open_cnt == 0)
+  {
+    list_remove(&c->elem);
+    kmem_cache_free(cache_entry_cache, c);
+    filesys_cache_size--;
+  }
+  lock_release(&filesys_cache_lock);
+}
+
+/* execute write back dirty cache every 5 time frequence, giving
+   the data appended to open files its sectors first */
 void write_cache_back_loop(void *aux UNUSED)
 {
   while (true)
   {
     timer_sleep(WRITE_BACK_WAIT_TIME);
+    inode_flush_all_delayed();
     filesys_cache_write_to_disk(false);
   }
 }
 
+/* Asks the read-ahead thread to bring SECTOR into the cache, so
+   that a later sequential read finds it there.  Never waits for
+   the disk; the request is dropped if SECTOR is already cached or
+   queued, or if the queue is full. */
+void spawn_thread_read_ahead(block_sector_t sector)
+{
+  size_t i;
+
+  lock_acquire(&filesys_cache_lock);
+  if (read_ahead_cnt < READ_AHEAD_QUEUE_SIZE
+      && get_block_in_cache(sector) == NULL)
+  {
+    for (i = 0; i < read_ahead_cnt; i++)
+      if (read_ahead_queue[(read_ahead_head + i) % READ_AHEAD_QUEUE_SIZE]
+          == sector)
+        break;
+    if (i == read_ahead_cnt)
+    {
+      read_ahead_queue[(read_ahead_head + read_ahead_cnt++)
+                       % READ_AHEAD_QUEUE_SIZE] = sector;
+      cond_signal(&read_ahead_cond, &filesys_cache_lock);
+    }
+  }
+  lock_release(&filesys_cache_lock);
+}
+
+/* Serves the requests queued by spawn_thread_read_ahead(),
+   reading each sector that is still not cached. */
+void thread_func_read_ahead(void *aux UNUSED)
+{
+  lock_acquire(&filesys_cache_lock);
+  while (true)
+  {
+    block_sector_t sector;
+
+    while (read_ahead_cnt == 0)
+      cond_wait(&read_ahead_cond, &filesys_cache_lock);
+    sector = read_ahead_queue[read_ahead_head];
+    read_ahead_head = (read_ahead_head + 1) % READ_AHEAD_QUEUE_SIZE;
+    read_ahead_cnt--;
+
+    if (get_block_in_cache(sector) == NULL)
+    {
+      struct cache_entry *c = cache_replace(sector, false);
+      if (c)
+      {
+        c->open_cnt--;
+        c->prefetched = true;
+        read_ahead_reads++;
+      }
+    }
+  }
+}
+
+/* Prints buffer cache statistics. */
+void filesys_cache_print_stats(void)
+{
+  printf("Cache: %lld hits, %lld misses, %lld sectors read ahead, "
+         "%lld misses avoided\n",
+         cache_hits, cache_misses, read_ahead_reads, read_ahead_hits);
+  printf("Cache: %u entries, %lld evicted under memory pressure\n",
+         (unsigned) filesys_cache_size, shrunk_entries);
+}
+
 /* Cache flash to disk, return the number of flash block*/
 int test_cache_flash(void) {
   int write_num = 0;
 
+  inode_flush_all_delayed();
   lock_acquire(&filesys_cache_lock);
   
   struct list_elem *next, *e = list_begin(&filesys_cache);
@@ -176,10 +575,9 @@ int test_cache_flash(void) {
   {
     next = list_next(e);
     struct cache_entry *c = list_entry(e, struct cache_entry, elem);
-    if (c->dirty)
+    if (c->dirty && !c->delayed)
     {
-      block_write(fs_device, c->sector, &c->block);
-      c->dirty = false;
+      write_back(c);
       write_num ++;
     }
     e = next;
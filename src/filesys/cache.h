@@ -7,7 +7,11 @@
 #include <list.h>
 
 #define WRITE_BACK_WAIT_TIME 5*TIMER_FREQ
-#define MAX_FILESYS_CACHE_SIZE 64                       /* maximum cache size of pintos */
+#define MAX_FILESYS_CACHE_SIZE 64                       /* usual maximum cache size of pintos */
+#define MIN_FILESYS_CACHE_SIZE 16                       /* size the shrinker stops at */
+#define READ_AHEAD_QUEUE_SIZE 32                        /* pending read-ahead requests */
+#define BLOCK_SECTOR_NONE ((block_sector_t) -1)         /* sector of a detached entry */
+#define DELAYED_CACHE_MAX (MAX_FILESYS_CACHE_SIZE / 2)  /* entries waiting for a sector */
 
 struct list filesys_cache;                              /* cache list */
 uint32_t filesys_cache_size;                            /* current cache number of pintos */
@@ -15,6 +19,8 @@ struct lock filesys_cache_lock;                         /* cache lock */
 
 struct list_elem* head;                                 /* head pointer for clock */
 
+struct inode;
+
 
 /** cache block
  * 
@@ -26,7 +32,11 @@ struct cache_entry {
   bool dirty;                                           /* dirty flag, true if the data was changed */
   bool ref_bit;                                         /* reference bit for clock algorithm */
   int open_cnt;                                         /* current opened number */
+  bool prefetched;                                      /* read ahead, not yet used */
   struct list_elem elem;                                /* list element for filesys_cache */
+  struct inode *owner;                                  /* inode whose dirty list holds this */
+  struct list_elem dirty_elem;                          /* list element for owner's dirty list */
+  bool delayed;                                         /* appended data, no sector yet */
 };
 
 void filesys_cache_init (void);
@@ -40,10 +50,23 @@ struct cache_entry *find_replace();
 
 
 void filesys_cache_write_to_disk (bool is_remove);
+void filesys_cache_mark_dirty (struct cache_entry *, struct inode *);
+void filesys_cache_sync (struct list *dirty_sectors);
+void filesys_cache_forget (struct list *dirty_sectors);
+void filesys_cache_demote (struct cache_entry *);
+void filesys_cache_demote_sector (block_sector_t sector);
+void filesys_cache_zero_block (block_sector_t sector, struct inode *);
+void filesys_cache_discard (block_sector_t sector);
+struct cache_entry *filesys_cache_new_delayed (void);
+void filesys_cache_place (struct cache_entry *, block_sector_t sector,
+                          struct inode *);
+void filesys_cache_drop (struct cache_entry *);
 void write_cache_back_loop (void *aux);
 void thread_func_read_ahead (void *aux);
 void spawn_thread_read_ahead (block_sector_t sector);
 
+void filesys_cache_print_stats (void);
+
 int test_cache_flash (void);
 int test_dirty_cache (void);
 
@@ -265,21 +265,33 @@ dir_remove (struct dir *dir, const char *name)
    NAME.  Returns true if successful, false if the directory
    contains no more entries. */
 bool
-dir_readdir (struct dir *dir, char name[NAME_MAX + 1], int order)
+dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
+{
+  return dir_read_entry (dir->inode, &dir->pos, name, NULL);
+}
+
+/* Reads the first entry at or after byte offset *POS in
+   directory INODE, skipping free entries and "." and "..", and
+   advances *POS past it.  Stores the entry's name in NAME and,
+   if SECTOR is non-null, its inode sector in *SECTOR.  Returns
+   true if successful, false if the directory contains no more
+   entries.  Keeping *POS between calls makes listing a directory
+   take one pass over it. */
+bool
+dir_read_entry (struct inode *inode, off_t *pos, char name[NAME_MAX + 1],
+                block_sector_t *sector)
 {
   struct dir_entry e;
-  int cnt = 0;
 
-  while (inode_read_at (dir->inode, &e, sizeof e, dir->pos) == sizeof e) 
+  while (inode_read_at (inode, &e, sizeof e, *pos) == sizeof e) 
     {
-      dir->pos += sizeof e;
+      *pos += sizeof e;
       if (e.in_use && strcmp (e.name, ".") && strcmp (e.name, ".."))
         {
-          cnt ++;
-          if(cnt==order){
-            strlcpy (name, e.name, NAME_MAX + 1);
-            return true;
-          }
+          strlcpy (name, e.name, NAME_MAX + 1);
+          if (sector != NULL)
+            *sector = e.inode_sector;
+          return true;
         } 
     }
   return false;
@@ -289,7 +301,8 @@ bool
 is_empty_dir (struct dir *dir)
 {
   char name[NAME_MAX + 1];
-  return !dir_readdir(dir, name, 1);
+  off_t pos = 0;
+  return !dir_read_entry (dir->inode, &pos, name, NULL);
 }
 
 
@@ -4,6 +4,7 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include "devices/block.h"
+#include "filesys/off_t.h"
 
 /* Maximum length of a file name component.
    This is the traditional UNIX maximum length.
@@ -28,7 +29,9 @@ struct inode *dir_get_inode (struct dir *);
 bool dir_lookup (const struct dir *, const char *name, struct inode **);
 bool dir_add (struct dir *, const char *name, block_sector_t);
 bool dir_remove (struct dir *, const char *name);
-bool dir_readdir (struct dir *, char name[NAME_MAX + 1], int order);
+bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+bool dir_read_entry (struct inode *, off_t *pos, char name[NAME_MAX + 1],
+                     block_sector_t *sector);
 
 /* hya add */
 bool is_empty_dir (struct dir *dir);
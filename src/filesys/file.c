@@ -2,15 +2,29 @@
 #include <debug.h>
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "filesys/directory.h"
 
+/* Object cache for open files. */
+static struct kmem_cache *file_cache;
+
+/* Initializes the file module. */
+void
+file_init (void) 
+{
+  file_cache = kmem_cache_create ("file", sizeof (struct file), NULL);
+  if (file_cache == NULL)
+    PANIC ("can't create file object cache");
+}
+
 /* Creates a file in the SECTOR, with LENGTH bytes long. 
    Returns inode for the file on success, null pointer on failure.
+   The space is reserved in one go and reads as zeros.
 */
 struct inode *
 file_create (block_sector_t sector, off_t length) 
 {
-  bool success = inode_create (sector, length, FILE_TYPE);
+  bool success = inode_create (sector, 0, FILE_TYPE);
 
 
  struct inode *inode = NULL;
@@ -20,8 +34,7 @@ file_create (block_sector_t sector, off_t length)
       free_map_release_at (sector);
   }
 
-  if (inode != NULL && length > 0
-      && inode_write_at (inode, "", 1, length - 1) != 1)
+  if (inode != NULL && !inode_allocate (inode, 0, length))
     {
       inode_remove (inode); 
       inode_close (inode);
@@ -37,7 +50,7 @@ file_create (block_sector_t sector, off_t length)
 struct file *
 file_open (struct inode *inode) 
 {
-  struct file *file = calloc (1, sizeof *file);
+  struct file *file = kmem_cache_alloc (file_cache);
   if (inode != NULL && file != NULL)
     {
       file->inode = inode;
@@ -48,7 +61,7 @@ file_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (file);
+      kmem_cache_free (file_cache, file);
       return NULL; 
     }
 }
@@ -69,7 +82,7 @@ file_close (struct file *file)
     {
       file_allow_write (file);
       inode_close (file->inode);
-      free (file); 
+      kmem_cache_free (file_cache, file);
     }
 }
 
@@ -133,6 +146,53 @@ file_write_at (struct file *file, const void *buffer, off_t size,
   return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Copies SIZE bytes from IN, starting at offset IN_OFS, into
+   OUT at offset OUT_OFS, without passing through a caller's
+   buffer.  Returns the number of bytes actually copied, which
+   may be less than SIZE if end of IN is reached.
+   The files' current positions are unaffected. */
+off_t
+file_copy_range (struct file *in, off_t in_ofs,
+                 struct file *out, off_t out_ofs, off_t size)
+{
+  return inode_copy_range (in->inode, in_ofs, out->inode, out_ofs, size);
+}
+
+/* Writes FILE's data that is still only in the buffer cache to
+   disk, and then its inode unless DATA_ONLY. */
+void
+file_sync (struct file *file, bool data_only)
+{
+  inode_sync (file->inode, data_only);
+}
+
+/* Passes ADVICE about how FILE will be accessed, for the LEN
+   bytes at OFFSET, to its inode; see inode_advise(). */
+void
+file_advise (struct file *file, off_t offset, off_t len, int advice)
+{
+  inode_advise (file->inode, offset, len, advice);
+}
+
+/* Makes sure the LEN bytes of FILE at OFFSET are allocated on
+   disk, extending FILE if they lie past its end, without writing
+   them; they read as zeros until written.  Returns false if the
+   disk is too full. */
+bool
+file_allocate (struct file *file, off_t offset, off_t len)
+{
+  return inode_allocate (file->inode, offset, offset + len);
+}
+
+/* Sets the length of FILE to LENGTH bytes, freeing the disk
+   space past LENGTH if it shrinks and leaving a hole if it
+   grows.  Returns false on failure. */
+bool
+file_truncate (struct file *file, off_t length)
+{
+  return inode_truncate (file->inode, length);
+}
+
 /* Prevents write operations on FILE's underlying inode
    until file_allow_write() is called or FILE is closed. */
 void
@@ -191,11 +251,16 @@ bool is_really_file(struct file* file){
   return file->inode->data.is_file==FILE_TYPE;
 }
 
-bool read_dir_by_file_node(struct file* file, char* name, int order){
+/* Reads the next entry of directory FILE into NAME and, if
+   SECTOR is non-null, its inode sector into *SECTOR.  The file
+   position serves as the directory cursor, so each open file
+   lists its directory once from start to end. */
+bool read_dir_by_file_node(struct file* file, char* name,
+                           block_sector_t *sector){
   if(is_really_file(file)){
     return false;
   }
-  return dir_readdir(dir_open(file->inode), name, order);
+  return dir_read_entry(file->inode, &file->pos, name, sector);
 }
 
 int get_inumber(struct file* file){
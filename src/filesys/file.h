@@ -19,6 +19,7 @@ struct file
 
 
 /* Opening and closing files. */
+void file_init (void);
 struct file *file_open (struct inode *);
 struct file *file_reopen (struct file *);
 void file_close (struct file *);
@@ -29,6 +30,12 @@ off_t file_read (struct file *, void *, off_t);
 off_t file_read_at (struct file *, void *, off_t size, off_t start);
 off_t file_write (struct file *, const void *, off_t);
 off_t file_write_at (struct file *, const void *, off_t size, off_t start);
+off_t file_copy_range (struct file *in, off_t in_ofs,
+                       struct file *out, off_t out_ofs, off_t size);
+void file_sync (struct file *, bool data_only);
+void file_advise (struct file *, off_t offset, off_t len, int advice);
+bool file_allocate (struct file *, off_t offset, off_t len);
+bool file_truncate (struct file *, off_t length);
 
 /* Preventing writes. */
 void file_deny_write (struct file *);
@@ -44,7 +51,8 @@ struct inode *file_create (block_sector_t sector, off_t length);
 
 /*add by hya, to get file type*/
 bool is_really_file(struct file* file);
-bool read_dir_by_file_node(struct file* file, char* name, int order);
+bool read_dir_by_file_node(struct file* file, char* name,
+                           block_sector_t *sector);
 int get_inumber(struct file* file);
 
 /* An open file. */
@@ -27,6 +27,7 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
   free_map_init ();
   // initial cache
   filesys_cache_init();
@@ -42,7 +43,8 @@ filesys_init (bool format)
 void
 filesys_done (void) 
 {
-  // write back all cache t
+  // give appended data its sectors, then write back all cache t
+  inode_flush_all_delayed ();
   filesys_cache_write_to_disk(true);
   
   free_map_close ();
@@ -10,6 +10,8 @@
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
 static struct lock free_map_lock;    /* Mutual exclusion. */
+static size_t free_cnt;              /* Number of free sectors... */
+static size_t promised_cnt;          /* ...and how many are promised. */
 
 /* Initializes the free map. */
 void
@@ -20,17 +22,24 @@ free_map_init (void)
     PANIC ("bitmap creation failed--file system device is too large");
   bitmap_mark (free_map, FREE_MAP_SECTOR);
   bitmap_mark (free_map, ROOT_DIR_SECTOR);
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
+  lock_init (&free_map_lock);
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
    the first into *SECTORP.
    Returns true if successful, false if not enough consecutive
-   sectors were available or if the free_map file could not be
+   sectors were available, short of those promised by
+   free_map_reserve(), or if the free_map file could not be
    written. */
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  block_sector_t sector = BITMAP_ERROR;
+
+  lock_acquire (&free_map_lock);
+  if (free_cnt - promised_cnt >= cnt)
+    sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
       && !bitmap_write (free_map, free_map_file))
@@ -39,17 +48,101 @@ free_map_allocate (size_t cnt, block_sector_t *sectorp)
       sector = BITMAP_ERROR;
     }
   if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+    {
+      *sectorp = sector;
+      free_cnt -= cnt;
+    }
+  lock_release (&free_map_lock);
   return sector != BITMAP_ERROR;
 }
 
+/* Allocates CNT sectors from the free map, consecutive ones if
+   possible, and stores them into SECTORS, writing the free_map
+   file once for all of them.  PROMISED sectors promised by
+   free_map_reserve() are used up, whether CNT needs them all or
+   not.
+   Returns true if successful, false, with nothing allocated or
+   used up, if not enough sectors were free or the free_map file
+   could not be written. */
+bool
+free_map_allocate_many (size_t cnt, block_sector_t sectors[], size_t promised)
+{
+  block_sector_t first;
+  size_t i;
+
+  lock_acquire (&free_map_lock);
+  if (free_cnt - (promised_cnt - promised) < cnt)
+    {
+      lock_release (&free_map_lock);
+      return false;
+    }
+  first = bitmap_scan_and_flip (free_map, 0, cnt, false);
+
+  if (first != BITMAP_ERROR)
+    for (i = 0; i < cnt; i++)
+      sectors[i] = first + i;
+  else
+    for (i = 0; i < cnt; i++)
+      {
+        sectors[i] = bitmap_scan_and_flip (free_map, i > 0 ? sectors[i - 1] : 0,
+                                           1, false);
+        if (sectors[i] == BITMAP_ERROR)
+          {
+            while (i-- > 0)
+              bitmap_reset (free_map, sectors[i]);
+            lock_release (&free_map_lock);
+            return false;
+          }
+      }
+  if (free_map_file != NULL && !bitmap_write (free_map, free_map_file))
+    {
+      for (i = 0; i < cnt; i++)
+        bitmap_reset (free_map, sectors[i]);
+      lock_release (&free_map_lock);
+      return false;
+    }
+  free_cnt -= cnt;
+  promised_cnt -= promised;
+  lock_release (&free_map_lock);
+  return true;
+}
+
+/* Promises CNT free sectors to a later free_map_allocate_many(),
+   so that no other allocation can take them meanwhile.  Returns
+   false if fewer than CNT sectors are free and unpromised. */
+bool
+free_map_reserve (size_t cnt)
+{
+  bool success;
+
+  lock_acquire (&free_map_lock);
+  success = free_cnt - promised_cnt >= cnt;
+  if (success)
+    promised_cnt += cnt;
+  lock_release (&free_map_lock);
+  return success;
+}
+
+/* Takes back a promise of CNT sectors made by free_map_reserve(). */
+void
+free_map_unreserve (size_t cnt)
+{
+  lock_acquire (&free_map_lock);
+  ASSERT (promised_cnt >= cnt);
+  promised_cnt -= cnt;
+  lock_release (&free_map_lock);
+}
+
 /* Makes CNT sectors starting at SECTOR available for use. */
 void
 free_map_release (block_sector_t sector, size_t cnt)
 {
+  lock_acquire (&free_map_lock);
   ASSERT (bitmap_all (free_map, sector, cnt));
   bitmap_set_multiple (free_map, sector, cnt, false);
+  free_cnt += cnt;
   bitmap_write (free_map, free_map_file);
+  lock_release (&free_map_lock);
 }
 
 /* Makes the sector at SECTOR available for use. */
@@ -59,6 +152,7 @@ free_map_release_at (block_sector_t sector)
   lock_acquire (&free_map_lock);
   ASSERT (bitmap_test (free_map, sector));
   bitmap_reset (free_map, sector);
+  free_cnt++;
   lock_release (&free_map_lock);
   // bitmap_write (free_map, free_map_file);
 }
@@ -72,6 +166,7 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
 }
 
 /* Writes the free map to disk and closes the free map file. */
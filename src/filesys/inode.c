@@ -1,26 +1,47 @@
 #include "filesys/inode.h"
 
+#include <advice.h>
 #include <debug.h>
 #include <round.h>
 #include <string.h>
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "cache.h"
 
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
-size_t inode_expand_single_block(struct inode *inode, size_t needed_allocated_sectors);
-size_t inode_expand_double_block(struct inode *inode, size_t needed_allocated_sectors);
-size_t inode_expand_double_block2(struct inode *inode, size_t needed_allocated_sectors, block_sector_t *level1_block);
+/* Number of sectors, one page worth, that a sequential read
+   asks the cache to read ahead of the reader. */
+#define READ_AHEAD_SECTORS 8
+
+/* Read-ahead window for files advised to be read sequentially. */
+#define READ_AHEAD_SECTORS_SEQUENTIAL 16
+
+/* Most index blocks a run of delayed blocks can need: a doubly
+   indirect block and the two indirect blocks the run may span. */
+#define DELAYED_INDEX_MAX 3
+
 bool allocate_inode(struct inode_disk *disk_inode);
+static size_t inode_fill_holes (struct inode *, size_t start, size_t end,
+                                bool count_only);
+static bool inode_reserve_holes (struct inode *, size_t start, size_t end,
+                                 size_t promised);
+static bool inode_uninline (struct inode *);
+static void inode_fill_promised (struct inode *, size_t start, size_t end,
+                                 size_t promised);
+static void inode_place_delayed (struct inode *);
+static void inode_flush_delayed (struct inode *);
 
 
 void deallocate_inode(struct inode *inode);
-void inode_dealloc_double_indirect_block(block_sector_t *ptr, size_t level1_sectors, size_t level0_sectors);
-void inode_dealloc_indirect_block(block_sector_t *ptr, size_t data_ptrs);
+void inode_dealloc_double_indirect_block(block_sector_t *ptr, size_t start, size_t end);
+void inode_dealloc_indirect_block(block_sector_t *ptr, size_t start, size_t end);
+static void inode_dealloc (struct inode *, size_t start, size_t end);
+static bool inode_alloc_sector (struct inode *, block_sector_t *);
 
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -32,29 +53,32 @@ bytes_to_data_sectors (off_t size)
 }
 
 
-/* added by Lu*/
+/* Returns the index of INODE's first data sector that has never
+   been written.  It and all later data sectors read as zeros and
+   have unknown contents on disk. */
 static size_t
-bytes_to_indirect_sectors(off_t size)
+first_unwritten (const struct inode *inode)
 {
-  if (size <= BLOCK_SECTOR_SIZE * DIRECT_POINTER_NUM)
-  {
-    return 0;
-  }
-  size -= BLOCK_SECTOR_SIZE * DIRECT_POINTER_NUM;
-  return DIV_ROUND_UP (size, BLOCK_SECTOR_SIZE * PTRS_PER_SECTOR);
+  return bytes_to_data_sectors (inode->data.length) - inode->data.unwritten_cnt;
 }
 
-static size_t bytes_to_double_indirect_sector(off_t size)
+/* Returns the delayed cache entry that holds data sector IDX of
+   INODE, or a null pointer if there is none.  The caller must
+   hold INODE's extend_lock. */
+static struct cache_entry *
+inode_delayed_entry (const struct inode *inode, size_t idx)
 {
-  if (size <= BLOCK_SECTOR_SIZE * (DIRECT_POINTER_NUM + PTRS_PER_SECTOR))
-  {
-    return 0;
-  }
-  return 1;
+  if (idx >= inode->delayed_start
+      && idx < inode->delayed_start + inode->delayed_cnt)
+    return inode->delayed[idx - inode->delayed_start];
+  return NULL;
 }
 
 /* Returns the block device sector that contains byte offset POS
-   within INODE.
+   within INODE, or 0 if POS falls in a hole, which reads as
+   zeros and has no sector until it is written, or if INODE's
+   data is inline.  (Sector 0 holds the free map, so it is never
+   a file's.)
    Returns -1 if INODE does not contain data for a byte at offset
    POS. */
 static block_sector_t
@@ -62,6 +86,9 @@ byte_to_sector (const struct inode *inode, off_t pos)
 {
   ASSERT (inode != NULL);
 
+  if (inode->data.is_inline)
+    return 0;
+
   if(pos < inode->data.length) {
     if(pos < DIRECT_POINTER_NUM * BLOCK_SECTOR_SIZE) 
     {
@@ -73,6 +100,8 @@ byte_to_sector (const struct inode *inode, off_t pos)
       uint32_t level1_table[PTRS_PER_SECTOR];
       pos -= DIRECT_POINTER_NUM * BLOCK_SECTOR_SIZE;
       level1_index = pos / BLOCK_SECTOR_SIZE;
+      if (inode->data.pointers[TOTAL_POINTER_NUM - 2] == 0)
+        return 0;
       block_read(fs_device, inode->data.pointers[TOTAL_POINTER_NUM - 2],
                  &level1_table);
       return level1_table[level1_index];
@@ -82,11 +111,15 @@ byte_to_sector (const struct inode *inode, off_t pos)
       uint32_t level_index;
       uint32_t level_table[PTRS_PER_SECTOR];
       // read the first level pointer table
+      if (inode->data.pointers[TOTAL_POINTER_NUM - 1] == 0)
+        return 0;
       block_read(fs_device, inode->data.pointers[TOTAL_POINTER_NUM - 1],
                  &level_table);
       pos -= (DIRECT_POINTER_NUM + PTRS_PER_SECTOR) * BLOCK_SECTOR_SIZE;
       level_index = pos / (PTRS_PER_SECTOR * BLOCK_SECTOR_SIZE);
       // read the second level pointer table
+      if (level_table[level_index] == 0)
+        return 0;
       block_read(fs_device, level_table[level_index], &level_table);
       pos -= level_index * (PTRS_PER_SECTOR * BLOCK_SECTOR_SIZE);
       return level_table[pos / BLOCK_SECTOR_SIZE];
@@ -99,14 +132,26 @@ byte_to_sector (const struct inode *inode, off_t pos)
 }
 
 /* List of open inodes, so that opening a single inode twice
-   returns the same `struct inode'. */
+   returns the same `struct inode'.  Most inode_open() calls find
+   the inode already open, so lookups share the lock and only
+   adding and removing inodes takes it exclusively. */
 static struct list open_inodes;
+static struct rwlock open_inodes_lock;
+
+/* Object cache for in-memory inodes. */
+static struct kmem_cache *inode_cache;
+
+static struct inode *open_inodes_lookup (block_sector_t);
 
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
   list_init (&open_inodes);
+  rwlock_init (&open_inodes_lock);
+  inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
+  if (inode_cache == NULL)
+    PANIC ("can't create inode object cache");
 }
 
 
@@ -130,7 +175,13 @@ inode_create (block_sector_t sector, off_t length, uint32_t is_file)
     disk_inode->magic = INODE_MAGIC;
     disk_inode-> is_file = is_file;
 
-     if (allocate_inode(disk_inode)) {
+    // data small enough stays inline, in the inode sector
+    if (length <= INODE_INLINE_MAX) {
+      disk_inode->is_inline = 1;
+      block_write(fs_device, sector, disk_inode);
+      success = true;
+    }
+    else if (allocate_inode(disk_inode)) {
         block_write(fs_device, sector, disk_inode);
         success = true;
       }
@@ -147,25 +198,31 @@ inode_create (block_sector_t sector, off_t length, uint32_t is_file)
 struct inode *
 inode_open (block_sector_t sector)
 {
-  struct list_elem *e;
   struct inode *inode;
 
   /* Check whether this inode is already open. */
-  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
-       e = list_next (e)) 
+  rwlock_acquire_read (&open_inodes_lock);
+  inode = inode_reopen (open_inodes_lookup (sector));
+  rwlock_release_read (&open_inodes_lock);
+  if (inode != NULL)
+    return inode;
+
+  /* Check again, since someone may have opened it meanwhile. */
+  rwlock_acquire_write (&open_inodes_lock);
+  inode = inode_reopen (open_inodes_lookup (sector));
+  if (inode != NULL)
     {
-      inode = list_entry (e, struct inode, elem);
-      if (inode->sector == sector) 
-        {
-          inode_reopen (inode);
-          return inode; 
-        }
+      rwlock_release_write (&open_inodes_lock);
+      return inode;
     }
 
   /* Allocate memory. */
-  inode = malloc (sizeof *inode);
+  inode = kmem_cache_alloc (inode_cache);
   if (inode == NULL)
-    return NULL;
+    {
+      rwlock_release_write (&open_inodes_lock);
+      return NULL;
+    }
 
   /* Initialize. */
   list_push_front (&open_inodes, &inode->elem);
@@ -177,19 +234,50 @@ inode_open (block_sector_t sector)
   
    /* added by Lu*/
   lock_init(&inode->extend_lock);
+  list_init (&inode->dirty_sectors);
+  inode->reserved = NULL;
+  inode->reserved_cnt = 0;
+  inode->promised_cnt = 0;
+  inode->delayed_start = inode->delayed_cnt = 0;
+  inode->delayed_promised = 0;
+  inode->advice = ADVICE_NORMAL;
+  inode->noreuse = false;
   block_read (fs_device, inode->sector, &inode->data);
   inode->length = inode->data.length;
   inode->length_for_read = inode->data.length;
+  rwlock_release_write (&open_inodes_lock);
 
   return inode;
 }
 
+/* Returns the open inode for SECTOR, or a null pointer if there
+   is none.  The caller must hold open_inodes_lock. */
+static struct inode *
+open_inodes_lookup (block_sector_t sector)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e)) 
+    {
+      struct inode *inode = list_entry (e, struct inode, elem);
+      if (inode->sector == sector) 
+        return inode;
+    }
+  return NULL;
+}
+
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode)
 {
   if (inode != NULL)
-    inode->open_cnt++;
+    {
+      /* Readers of open_inodes_lock may do this concurrently. */
+      enum intr_level old_level = intr_disable ();
+      inode->open_cnt++;
+      intr_set_level (old_level);
+    }
   return inode;
 }
 
@@ -211,10 +299,26 @@ inode_close (struct inode *inode)
     return;
 
   /* Release resources if this was the last opener. */
+  rwlock_acquire_write (&open_inodes_lock);
   if (--inode->open_cnt == 0)
     {
       /* Remove from inode list and release lock. */
       list_remove (&inode->elem);
+      rwlock_release_write (&open_inodes_lock);
+
+      /* Data appended to a removed file never needs to reach the
+         disk; otherwise it gets its sectors now. */
+      if (inode->removed)
+        {
+          size_t i;
+          for (i = 0; i < inode->delayed_cnt; i++)
+            filesys_cache_drop (inode->delayed[i]);
+          free_map_unreserve (inode->delayed_promised);
+          inode->delayed_cnt = 0;
+        }
+      else
+        inode_flush_delayed (inode);
+      filesys_cache_forget (&inode->dirty_sectors);
  
       /* Deallocate blocks if removed. */
       if (inode->removed) 
@@ -226,8 +330,10 @@ inode_close (struct inode *inode)
           //                   bytes_to_data_sectors (inode->data.length)); 
         }
 
-      free (inode); 
+      kmem_cache_free (inode_cache, inode);
     }
+  else
+    rwlock_release_write (&open_inodes_lock);
 }
 
 
@@ -241,6 +347,54 @@ inode_remove (struct inode *inode)
   inode->removed = true;
 }
 
+/* Queues read-ahead of the sectors of INODE that follow byte
+   offset POS, stopping at READ_LENGTH.  Only sectors reached
+   through direct pointers are considered, since finding the
+   others would mean reading index blocks synchronously, nor
+   holes and unwritten sectors, which are never read.  Files
+   advised to be sequential get a larger window. */
+static void
+inode_read_ahead (const struct inode *inode, off_t pos, off_t read_length)
+{
+  int window = (inode->advice == ADVICE_SEQUENTIAL
+                ? READ_AHEAD_SECTORS_SEQUENTIAL : READ_AHEAD_SECTORS);
+  off_t written = first_unwritten (inode) * BLOCK_SECTOR_SIZE;
+  int i;
+
+  for (i = 0; i < window; i++, pos += BLOCK_SECTOR_SIZE)
+    {
+      block_sector_t sector;
+      if (pos >= read_length || pos >= written
+          || pos >= DIRECT_POINTER_NUM * BLOCK_SECTOR_SIZE)
+        break;
+      sector = byte_to_sector (inode, pos);
+      if (sector != 0)
+        spawn_thread_read_ahead (sector);
+    }
+}
+
+/* Copies up to SIZE bytes of INODE's inline data, starting at
+   OFFSET and stopping at READ_LENGTH, into BUFFER.  Returns the
+   number of bytes copied, or -1 if the data has been moved out
+   to a sector meanwhile. */
+static off_t
+inode_read_inline (struct inode *inode, void *buffer, off_t size,
+                   off_t offset, off_t read_length)
+{
+  off_t bytes_read = -1;
+
+  if (inode->data.is_file)
+    lock_acquire (&inode->extend_lock);
+  if (inode->data.is_inline)
+    {
+      bytes_read = read_length - offset < size ? read_length - offset : size;
+      memcpy (buffer, inode->data.inline_data + offset, bytes_read);
+    }
+  if (inode->data.is_file)
+    lock_release (&inode->extend_lock);
+  return bytes_read;
+}
+
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
    Returns the number of bytes actually read, which may be less
    than SIZE if an error occurs or end of file is reached. */
@@ -258,10 +412,18 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
     return bytes_read;
   }
 
+  if (inode->data.is_inline)
+    {
+      bytes_read = inode_read_inline (inode, buffer, size, offset,
+                                      read_length);
+      if (bytes_read >= 0)
+        return bytes_read;
+      bytes_read = 0;
+    }
+
   while (size > 0) 
     {
-      /* Disk sector to read, starting byte offset within sector. */
-      block_sector_t sector_idx = byte_to_sector (inode, offset);
+      /* Starting byte offset within sector. */
       int sector_ofs = offset % BLOCK_SECTOR_SIZE;
 
       /* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -274,12 +436,46 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       if (chunk_size <= 0)
         break;
 
-      /* write to cache */
-      struct cache_entry *c = filesys_cache_get_block(sector_idx, false);
-      memcpy (buffer + bytes_read, (uint8_t *) &c->block + sector_ofs,
-	      chunk_size);
-      c->ref_bit = true;
-      c->open_cnt--;
+      /* a file's sector is looked up and copied under its
+         extend_lock, so that a truncate cannot free it meanwhile;
+         stop if one has cut the file short */
+      bool locked = inode->data.is_file;
+      if (locked)
+        {
+          lock_acquire (&inode->extend_lock);
+          if (offset >= inode->length_for_read)
+            {
+              lock_release (&inode->extend_lock);
+              break;
+            }
+        }
+
+      /* a hole, or a sector never written, reads as zeros,
+         without the disk, unless data appended to the file but
+         not yet given a sector is there */
+      block_sector_t sector_idx = 0;
+      struct cache_entry *delayed = NULL;
+      if ((size_t) (offset / BLOCK_SECTOR_SIZE) < first_unwritten (inode))
+        sector_idx = byte_to_sector (inode, offset);
+      if (sector_idx == 0 && locked)
+        delayed = inode_delayed_entry (inode, offset / BLOCK_SECTOR_SIZE);
+      if (delayed != NULL)
+        memcpy (buffer + bytes_read, delayed->block + sector_ofs, chunk_size);
+      else if (sector_idx == 0)
+        memset (buffer + bytes_read, 0, chunk_size);
+      else
+        {
+          struct cache_entry *c = filesys_cache_get_block(sector_idx, false);
+          memcpy (buffer + bytes_read, (uint8_t *) &c->block + sector_ofs,
+                  chunk_size);
+          if (inode->noreuse)
+            filesys_cache_demote (c);
+          else
+            c->ref_bit = true;
+          c->open_cnt--;
+        }
+      if (locked)
+        lock_release (&inode->extend_lock);
       
       /* Advance. */
       size -= chunk_size;
@@ -287,9 +483,257 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
       bytes_read += chunk_size;
     }
 
+  /* A read that stops at a sector boundary is most likely
+     sequential, so start fetching what comes next, unless the
+     file was advised to be read randomly. */
+  if (bytes_read > 0 && offset % BLOCK_SECTOR_SIZE == 0
+      && inode->advice != ADVICE_RANDOM)
+    inode_read_ahead (inode, offset, read_length);
+
   return bytes_read;
 }
 
+/* Zeroes, in the buffer cache, the unwritten sectors of INODE
+   that start before byte offset END, so that a write ending at
+   END leaves no unwritten sector in front of a written one.
+   Returns true if there were any, in which case the inode needs
+   to be written back. */
+static bool
+inode_fill_unwritten (struct inode *inode, off_t end)
+{
+  size_t first = first_unwritten (inode);
+  size_t last = bytes_to_data_sectors (end);
+  size_t idx;
+
+  if (inode->data.unwritten_cnt == 0 || last <= first)
+    return false;
+  if (last > first + inode->data.unwritten_cnt)
+    last = first + inode->data.unwritten_cnt;
+  for (idx = first; idx < last; idx++)
+    filesys_cache_zero_block (byte_to_sector (inode, idx * BLOCK_SECTOR_SIZE),
+                              inode);
+  inode->data.unwritten_cnt -= last - first;
+  return true;
+}
+
+/* Gets INODE ready for a write of the bytes from OFFSET up to
+   END: moves inline data out to a sector, fills in unwritten
+   sectors before END, and, if INODE is shorter than END, extends
+   it, allocating the sectors the write covers all at once if
+   ALLOCATE, or else leaving them for inode_write_delayed().
+   Whatever lies between the old end and OFFSET is left as a
+   hole.  Writes the inode to disk if any of that changed it.
+   Returns false if the inline data could not be moved out. */
+static bool
+inode_prepare_write (struct inode *inode, off_t offset, off_t end,
+                     bool allocate)
+{
+  bool changed = false;
+
+  if (inode->data.is_file)
+  {
+    lock_acquire(&inode->extend_lock);
+  }
+  if (inode->data.is_inline)
+  {
+    if (!inode_uninline(inode))
+    {
+      if (inode->data.is_file)
+        lock_release(&inode->extend_lock);
+      return false;
+    }
+    changed = true;
+  }
+  if (inode_fill_unwritten (inode, end))
+    changed = true;
+  if (end > inode_length (inode))
+  {
+    inode->length = end;
+    inode->data.length = inode->length;
+    if (allocate)
+      inode_fill_holes (inode, offset / BLOCK_SECTOR_SIZE,
+                        bytes_to_data_sectors (end), false);
+    changed = true;
+  }
+
+  // write the extended information to the disk
+  if (changed)
+    block_write(fs_device, inode->sector, &inode->data);
+
+  if (inode->data.is_file)
+  {
+    lock_release(&inode->extend_lock);
+  }
+  return true;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE's inline data at
+   OFFSET, extending it if needed, and writes the inode to disk.
+   Returns SIZE, or -1, changing nothing, if the data is not
+   inline or would not fit. */
+static off_t
+inode_write_inline (struct inode *inode, const void *buffer, off_t size,
+                    off_t offset)
+{
+  off_t bytes_written = -1;
+
+  if (inode->data.is_file)
+    lock_acquire (&inode->extend_lock);
+  if (inode->data.is_inline && offset + size <= INODE_INLINE_MAX)
+    {
+      memcpy (inode->data.inline_data + offset, buffer, size);
+      if (offset + size > inode_length (inode))
+        inode->length = inode->data.length = offset + size;
+      block_write (fs_device, inode->sector, &inode->data);
+      bytes_written = size;
+    }
+  if (inode->data.is_file)
+    lock_release (&inode->extend_lock);
+  return bytes_written;
+}
+
+/* Adds a delayed block for data sector IDX to the end of INODE's
+   run of them, promising it, and the index blocks its run may
+   need, a free sector, and returns the block's cache entry.
+   Returns a null pointer if the cache or the disk has no room to
+   spare.  The caller must hold INODE's extend_lock. */
+static struct cache_entry *
+inode_new_delayed (struct inode *inode, size_t idx)
+{
+  size_t need = inode->delayed_cnt == 0 ? 1 + DELAYED_INDEX_MAX : 1;
+  struct cache_entry *c;
+
+  if (!free_map_reserve (need))
+    return NULL;
+  c = filesys_cache_new_delayed ();
+  if (c == NULL)
+    {
+      free_map_unreserve (need);
+      return NULL;
+    }
+  if (inode->delayed_cnt == 0)
+    inode->delayed_start = idx;
+  inode->delayed[inode->delayed_cnt++] = c;
+  inode->delayed_promised += need;
+  return c;
+}
+
+/* Writes CHUNK_SIZE bytes from BUFFER at OFFSET of INODE, which
+   was a hole when last looked at, into a delayed block: a dirty
+   cache entry that gets its sector only when the buffer cache
+   is about to write it back.  INODE's delayed blocks must be
+   consecutive, so a full run, or one the hole does not extend,
+   is given its sectors first.  Returns false if the bytes must
+   go to a sector of their own now instead: INODE is a
+   directory, the hole was filled meanwhile, or there is no room
+   to spare. */
+static bool
+inode_write_delayed (struct inode *inode, const void *buffer, off_t offset,
+                     int chunk_size)
+{
+  size_t idx = offset / BLOCK_SECTOR_SIZE;
+  struct cache_entry *c;
+
+  if (!inode->data.is_file)
+    return false;
+  lock_acquire (&inode->extend_lock);
+  c = inode_delayed_entry (inode, idx);
+  if (c == NULL && byte_to_sector (inode, offset) == 0)
+    {
+      if (inode->delayed_cnt == DELAYED_RUN_MAX
+          || (inode->delayed_cnt > 0
+              && idx != inode->delayed_start + inode->delayed_cnt))
+        inode_place_delayed (inode);
+      c = inode_new_delayed (inode, idx);
+      if (c == NULL && inode->delayed_cnt > 0)
+        {
+          inode_place_delayed (inode);
+          c = inode_new_delayed (inode, idx);
+        }
+    }
+  if (c != NULL)
+    memcpy (c->block + offset % BLOCK_SECTOR_SIZE, buffer, chunk_size);
+  lock_release (&inode->extend_lock);
+  return c != NULL;
+}
+
+/* Gives INODE's delayed blocks sectors of their own, allocated
+   with the index blocks they need in a single free map update,
+   consecutive if possible, out of the sectors promised to them,
+   or one at a time if that update fails.  They become ordinary
+   dirty cache entries, written back like any other.  Panics if
+   a block still finds no sector.  The caller must hold INODE's
+   extend_lock. */
+static void
+inode_place_delayed (struct inode *inode)
+{
+  size_t start = inode->delayed_start;
+  size_t end = start + inode->delayed_cnt;
+  size_t i;
+
+  if (inode->delayed_cnt == 0)
+    return;
+  if (!inode_reserve_holes (inode, start, end, inode->delayed_promised))
+    inode_fill_promised (inode, start, end, inode->delayed_promised);
+  inode->delayed_promised = 0;
+
+  /* write() has already reported these blocks written, so there
+     is no one left to tell that they are lost */
+  for (i = 0; i < inode->delayed_cnt; i++)
+    if (inode->delayed[i] != NULL)
+      PANIC ("no sector for delayed data of inode %"PRDSNu,
+             inode->sector);
+  inode->delayed_cnt = 0;
+  block_write (fs_device, inode->sector, &inode->data);
+}
+
+/* Gives INODE's delayed blocks their sectors, if it has any. */
+static void
+inode_flush_delayed (struct inode *inode)
+{
+  if (!inode->data.is_file || inode->delayed_cnt == 0)
+    return;
+  lock_acquire (&inode->extend_lock);
+  inode_place_delayed (inode);
+  lock_release (&inode->extend_lock);
+}
+
+/* Gives the delayed blocks of every open inode their sectors, so
+   that the buffer cache can write them back. */
+void
+inode_flush_all_delayed (void)
+{
+  struct list_elem *e;
+
+  rwlock_acquire_read (&open_inodes_lock);
+  for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
+       e = list_next (e))
+    inode_flush_delayed (list_entry (e, struct inode, elem));
+  rwlock_release_read (&open_inodes_lock);
+}
+
+/* Allocates the hole of INODE at byte offset POS, about to be
+   written, and returns its new sector, or 0 if the disk is
+   full. */
+static block_sector_t
+inode_fill_hole (struct inode *inode, off_t pos)
+{
+  size_t idx = pos / BLOCK_SECTOR_SIZE;
+  block_sector_t sector;
+
+  if (inode->data.is_file)
+    lock_acquire (&inode->extend_lock);
+  sector = byte_to_sector (inode, pos);
+  if (sector == 0 && inode_fill_holes (inode, idx, idx + 1, false) > 0)
+    {
+      block_write (fs_device, inode->sector, &inode->data);
+      sector = byte_to_sector (inode, pos);
+    }
+  if (inode->data.is_file)
+    lock_release (&inode->extend_lock);
+  return sector;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
    Returns the number of bytes actually written, which may be
    less than SIZE if end of file is reached or an error occurs.
@@ -305,24 +749,23 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   if (inode->deny_write_cnt)
     return 0;
 
-   // extend the file
-  if (offset + size > inode_length(inode))
-  {
-    if (inode->data.is_file)
+  // small data goes in the inode sector itself while it fits
+  if (inode->data.is_inline)
     {
-      lock_acquire(&inode->extend_lock);
+      bytes_written = inode_write_inline (inode, buffer, size, offset);
+      if (bytes_written >= 0)
+        {
+          inode->length_for_read = inode->length;
+          return bytes_written;
+        }
+      bytes_written = 0;
     }
-    inode->length = inode_extend(inode, offset + size);
-    inode->data.length = inode->length;
 
-    // write the extended information to the disk
-    block_write(fs_device, inode->sector, &inode->data);
-
-    if (inode->data.is_file)
-    {
-      lock_release(&inode->extend_lock);
-    }
-  }
+   // extend the file, and fill in sectors preallocated but unwritten;
+   // a file's new sectors wait for write-back to be allocated
+  if (!inode_prepare_write(inode, offset, offset + size,
+                           !inode->data.is_file))
+    return 0;
 
   while (size > 0) 
     {
@@ -340,13 +783,30 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
       if (chunk_size <= 0)
         break;
 
+      /* a hole of a file gets a delayed block, or else its sector
+         now; stop if the disk is full */
+      bool delayed = sector_idx == 0
+        && inode_write_delayed (inode, buffer + bytes_written, offset,
+                                chunk_size);
+      if (sector_idx == 0 && !delayed)
+        sector_idx = inode_fill_hole (inode, offset);
+      if (sector_idx == 0 && !delayed)
+        break;
+
       /* write to cache */
-      struct cache_entry *cache = filesys_cache_get_block(sector_idx, true);
-      memcpy ((uint8_t *) &cache->block + sector_ofs, buffer + bytes_written,
-	      chunk_size);
-      cache->ref_bit = true;
-      cache->dirty = true;
-      cache->open_cnt--;
+      if (!delayed)
+        {
+          struct cache_entry *cache = filesys_cache_get_block (sector_idx,
+                                                               true);
+          memcpy ((uint8_t *) &cache->block + sector_ofs,
+                  buffer + bytes_written, chunk_size);
+          if (inode->noreuse)
+            filesys_cache_demote (cache);
+          else
+            cache->ref_bit = true;
+          filesys_cache_mark_dirty (cache, inode);
+          cache->open_cnt--;
+        }
 
       /* Advance. */
       size -= chunk_size;
@@ -359,6 +819,157 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
   return bytes_written;
 }
 
+/* Copies SIZE bytes of IN, starting at IN_OFS, into OUT at
+   OUT_OFS, moving the data directly from one buffer cache entry
+   to the other.  OUT is extended to its final length before the
+   copy starts.  Returns the number of bytes actually copied,
+   which may be less than SIZE if end of IN is reached. */
+off_t
+inode_copy_range (struct inode *in, off_t in_ofs,
+                  struct inode *out, off_t out_ofs, off_t size)
+{
+  off_t bytes_copied = 0;
+
+  if (out->deny_write_cnt || in_ofs >= in->length_for_read)
+    return 0;
+  if (size > in->length_for_read - in_ofs)
+    size = in->length_for_read - in_ofs;
+
+  /* copies from inline data, or small enough to stay inline,
+     have no cache entries to move between */
+  if (in->data.is_inline
+      || (out->data.is_inline && out_ofs + size <= INODE_INLINE_MAX))
+    {
+      uint8_t buf[INODE_INLINE_MAX];
+      if (size > INODE_INLINE_MAX)
+        size = INODE_INLINE_MAX;
+      size = inode_read_at (in, buf, size, in_ofs);
+      return inode_write_at (out, buf, size, out_ofs);
+    }
+  inode_flush_delayed (in);
+  inode_flush_delayed (out);
+  if (!inode_prepare_write (out, out_ofs, out_ofs + size, true))
+    return 0;
+
+  while (size > 0)
+    {
+      /* Source and destination sectors and offsets within them. */
+      block_sector_t in_sector = 0;
+      if ((size_t) (in_ofs / BLOCK_SECTOR_SIZE) < first_unwritten (in))
+        in_sector = byte_to_sector (in, in_ofs);
+      block_sector_t out_sector = byte_to_sector (out, out_ofs);
+      int in_sector_ofs = in_ofs % BLOCK_SECTOR_SIZE;
+      int out_sector_ofs = out_ofs % BLOCK_SECTOR_SIZE;
+
+      /* Bytes left in OUT and in either sector, least of the three. */
+      off_t inode_left = inode_length (out) - out_ofs;
+      int in_left = BLOCK_SECTOR_SIZE - in_sector_ofs;
+      int out_left = BLOCK_SECTOR_SIZE - out_sector_ofs;
+      int min_left = in_left < out_left ? in_left : out_left;
+      if (inode_left < min_left)
+        min_left = inode_left;
+
+      /* Number of bytes to actually copy between the sectors. */
+      int chunk_size = size < min_left ? size : min_left;
+      if (chunk_size <= 0)
+        break;
+      if (out_sector == 0)
+        out_sector = inode_fill_hole (out, out_ofs);
+      if (out_sector == 0)
+        break;
+
+      /* copy between caches; both may be the same entry, and a
+         source hole or sector never written copies as zeros */
+      struct cache_entry *dst = filesys_cache_get_block (out_sector, true);
+      if (in_sector == 0)
+        memset ((uint8_t *) &dst->block + out_sector_ofs, 0, chunk_size);
+      else
+        {
+          struct cache_entry *src = filesys_cache_get_block (in_sector, false);
+          memmove ((uint8_t *) &dst->block + out_sector_ofs,
+                   (uint8_t *) &src->block + in_sector_ofs, chunk_size);
+          src->open_cnt--;
+        }
+      filesys_cache_mark_dirty (dst, out);
+      dst->open_cnt--;
+
+      /* Advance. */
+      size -= chunk_size;
+      in_ofs += chunk_size;
+      out_ofs += chunk_size;
+      bytes_copied += chunk_size;
+    }
+
+  out->length_for_read = out->length;
+
+  return bytes_copied;
+}
+
+/* Writes INODE's dirty data sectors to disk, then, unless
+   DATA_ONLY, the inode itself.  This orders nothing against a
+   crash: index blocks, and the inode whenever it grows, are
+   written through as soon as sectors are allocated, while the
+   data of those sectors may still be only in the buffer cache.
+   After a crash, a file can point at sectors holding what was
+   last written there, until an fsync has covered them. */
+void
+inode_sync (struct inode *inode, bool data_only)
+{
+  inode_flush_delayed (inode);
+  filesys_cache_sync (&inode->dirty_sectors);
+  if (!data_only)
+    {
+      lock_acquire (&inode->extend_lock);
+      block_write (fs_device, inode->sector, &inode->data);
+      lock_release (&inode->extend_lock);
+    }
+}
+
+/* Applies ADVICE, an ADVICE_* hint, to INODE.  WILLNEED and
+   DONTNEED act on the LEN bytes at OFFSET, or on everything from
+   OFFSET on if LEN is 0: WILLNEED queues them for read-ahead, up
+   to what the read-ahead queue holds, and DONTNEED makes those
+   already cached the first to be evicted.  The other hints set
+   the access pattern of the whole file. */
+void
+inode_advise (struct inode *inode, off_t offset, off_t len, int advice)
+{
+  off_t end = inode->length_for_read;
+  off_t pos = ROUND_DOWN (offset, BLOCK_SECTOR_SIZE);
+  block_sector_t sector;
+  int i;
+
+  if (len > 0 && len < end - offset)
+    end = offset + len;
+  switch (advice)
+    {
+    case ADVICE_WILLNEED:
+      for (i = 0; i < READ_AHEAD_QUEUE_SIZE && pos < end;
+           i++, pos += BLOCK_SECTOR_SIZE)
+        {
+          sector = byte_to_sector (inode, pos);
+          if (sector != 0)
+            spawn_thread_read_ahead (sector);
+        }
+      break;
+    case ADVICE_DONTNEED:
+      for (; pos < end; pos += BLOCK_SECTOR_SIZE)
+        {
+          sector = byte_to_sector (inode, pos);
+          if (sector != 0)
+            filesys_cache_demote_sector (sector);
+        }
+      break;
+    case ADVICE_NOREUSE:
+      inode->noreuse = true;
+      break;
+    default:
+      inode->advice = advice;
+      inode->noreuse = false;
+      break;
+    }
+}
+
 /* Disables writes to INODE.
    May be called at most once per inode opener. */
 void
@@ -387,217 +998,485 @@ inode_length (const struct inode *inode)
 }
 
 
-/** extend the file size to NEW_LENGTH (in bytes) 
-*   return NEW_LENGTH if allocated success
-*/
-off_t inode_extend(struct inode *inode, off_t new_length)
+/* Allocates a sector into *SLOT, the pointer to data sector IDX
+   of INODE, if it is a hole.  A delayed block for IDX becomes
+   the sector's cache entry; otherwise a sector within INODE's
+   length is zeroed in the buffer cache, and one past it is left
+   for the caller to count as unwritten.  Returns 1 if *SLOT was
+   a hole, else 0. */
+static size_t
+inode_fill_data (struct inode *inode, block_sector_t *slot, size_t idx,
+                 bool count_only)
 {
-  static char zeros[BLOCK_SECTOR_SIZE];
-  size_t needed_allocated_sectors = bytes_to_data_sectors(new_length) -
-                            bytes_to_data_sectors(inode->length);
-
-  if (needed_allocated_sectors == 0)
-  {
-    return new_length;
-  }
+  block_sector_t sector;
 
-  /* allocate for the sector that direct pointer points to */
-  while (inode->data.level0_ptr_index < DIRECT_POINTER_NUM)
-  {
-    free_map_allocate(1, &inode->data.pointers[inode->data.level0_ptr_index]);
-    block_write(fs_device, inode->data.pointers[inode->data.level0_ptr_index], zeros);
-    inode->data.level0_ptr_index ++;
-    needed_allocated_sectors--;
-    if (needed_allocated_sectors == 0)
-    {
-      return new_length;
-    }
-  }
-  /* allocate for the sector of single indirect pointers */
-  if (inode->data.level0_ptr_index == DIRECT_POINTER_NUM)
-  {
-    needed_allocated_sectors = inode_expand_single_block(inode, needed_allocated_sectors);
-    if (needed_allocated_sectors == 0)
+  if (*slot != 0)
+    return 0;
+  if (!count_only && inode_alloc_sector (inode, &sector))
     {
-      return new_length;
+      struct cache_entry *c = NULL;
+      if (inode->data.is_file)
+        c = inode_delayed_entry (inode, idx);
+      if (c != NULL)
+        {
+          filesys_cache_place (c, sector, inode);
+          inode->delayed[idx - inode->delayed_start] = NULL;
+        }
+      else if (idx < bytes_to_data_sectors (inode->data.length))
+        filesys_cache_zero_block (sector, inode);
+      *slot = sector;
     }
-  }
-  if (inode->data.level0_ptr_index == DIRECT_POINTER_NUM + SINGLE_POINTER_NUM)
-  {
-    needed_allocated_sectors = inode_expand_double_block(inode, needed_allocated_sectors);
-  }
-  return new_length - needed_allocated_sectors * BLOCK_SECTOR_SIZE;
+  return 1;
 }
 
-size_t inode_expand_single_block(struct inode *inode, size_t needed_allocated_sectors)
+/* Fills the holes among data sectors START up to END of INODE
+   that hang off the index block *PTR, allocating *PTR first if
+   it is a hole itself.  The block points to data sectors if
+   DEPTH is 1, or to such index blocks if it is 2; its first
+   pointer leads to data sector BASE.  A new block is written
+   before *PTR points to it, for readers that don't lock.
+   Returns the number of sectors allocated, or that would be if
+   COUNT_ONLY. */
+static size_t
+inode_fill_index (struct inode *inode, block_sector_t *ptr, int depth,
+                  size_t base, size_t start, size_t end, bool count_only)
 {
-  static char zeros[BLOCK_SECTOR_SIZE];
   block_sector_t ptr_block[PTRS_PER_SECTOR];
-  if (inode->data.level1_ptr_index == 0)
+  block_sector_t sector = *ptr;
+  size_t span = depth == 1 ? 1 : PTRS_PER_SECTOR;
+  size_t cnt = 0;
+  size_t i;
+
+  if (sector == 0)
   {
-    free_map_allocate(1, &inode->data.pointers[inode->data.level0_ptr_index]);
+    cnt++;
+    if (!count_only && !inode_alloc_sector(inode, &sector))
+      return cnt;
+    memset(ptr_block, 0, sizeof ptr_block);
   }
   else
   {
-    block_read(fs_device, inode->data.pointers[inode->data.level0_ptr_index], &ptr_block);
+    block_read(fs_device, sector, &ptr_block);
   }
-  while (inode->data.level1_ptr_index < PTRS_PER_SECTOR)
+  for (i = (start - base) / span; i < PTRS_PER_SECTOR && base + i * span < end; i++)
   {
-    free_map_allocate(1, &ptr_block[inode->data.level1_ptr_index]);
-    block_write(fs_device, ptr_block[inode->data.level1_ptr_index], zeros);
-    inode->data.level1_ptr_index ++;
-    needed_allocated_sectors--;
-    if (needed_allocated_sectors == 0)
-    {
-      break;
-    }
+    size_t lo = base + i * span;
+    if (depth == 1)
+      cnt += inode_fill_data(inode, &ptr_block[i], lo, count_only);
+    else
+      cnt += inode_fill_index(inode, &ptr_block[i], 1, lo,
+                              start > lo ? start : lo,
+                              end < lo + span ? end : lo + span, count_only);
   }
-  block_write(fs_device, inode->data.pointers[inode->data.level0_ptr_index], &ptr_block);
-  if (inode->data.level1_ptr_index == PTRS_PER_SECTOR)
+  if (!count_only && cnt > 0)
   {
-    inode->data.level1_ptr_index = 0;
-    inode->data.level0_ptr_index ++;
+    block_write(fs_device, sector, &ptr_block);
+    *ptr = sector;
   }
-  return needed_allocated_sectors;
+  return cnt;
 }
 
-size_t inode_expand_double_block(struct inode *inode,
-                                          size_t needed_allocated_sectors)
+/* Fills the holes among data sectors START up to END of INODE,
+   allocating the index blocks they need on the way, one sector
+   at a time unless sectors were reserved.  Returns the number
+   of sectors allocated, or that would be if COUNT_ONLY. */
+static size_t
+inode_fill_holes (struct inode *inode, size_t start, size_t end,
+                  bool count_only)
 {
-  block_sector_t ptr_block[PTRS_PER_SECTOR];
-  if (inode->data.level2_ptr_index == 0 && inode->data.level1_ptr_index == 0)
+  size_t double_start = DIRECT_POINTER_NUM + PTRS_PER_SECTOR;
+  size_t cnt = 0;
+  size_t i;
+
+  for (i = start; i < end && i < DIRECT_POINTER_NUM; i++)
   {
-    free_map_allocate(1, &inode->data.pointers[inode->data.level0_ptr_index]);
+    cnt += inode_fill_data(inode, &inode->data.pointers[i], i, count_only);
   }
-  else
+  if (end > DIRECT_POINTER_NUM && start < double_start)
   {
-    block_read(fs_device, inode->data.pointers[inode->data.level0_ptr_index], &ptr_block);
+    cnt += inode_fill_index(inode, &inode->data.pointers[DIRECT_POINTER_NUM], 1,
+                            DIRECT_POINTER_NUM,
+                            start > DIRECT_POINTER_NUM ? start : DIRECT_POINTER_NUM,
+                            end < double_start ? end : double_start, count_only);
   }
-
-  while (inode->data.level1_ptr_index < PTRS_PER_SECTOR)
+  if (end > double_start)
   {
-    needed_allocated_sectors = inode_expand_double_block2(inode, needed_allocated_sectors, &ptr_block);
-    if (needed_allocated_sectors == 0)
-    {
-      break;
-    }
+    cnt += inode_fill_index(inode,
+                            &inode->data.pointers[DIRECT_POINTER_NUM + SINGLE_POINTER_NUM],
+                            2, double_start,
+                            start > double_start ? start : double_start, end,
+                            count_only);
   }
-  block_write(fs_device, inode->data.pointers[inode->data.level0_ptr_index], &ptr_block);
-  return needed_allocated_sectors;
+  return cnt;
 }
 
-size_t inode_expand_double_block2(struct inode *inode,
-                                                  size_t needed_allocated_sectors,
-                                                  block_sector_t *level1_block)
+/* Fills the holes among data sectors START up to END of INODE
+   one sector at a time, out of PROMISED sectors promised by
+   free_map_reserve(), and gives back the promise of any left
+   over. */
+static void
+inode_fill_promised (struct inode *inode, size_t start, size_t end,
+                     size_t promised)
 {
-  
-  static char zeros[BLOCK_SECTOR_SIZE];
-  block_sector_t level2_block[PTRS_PER_SECTOR];
-  if (inode->data.level2_ptr_index == 0)
-  {
-    free_map_allocate(1, &level1_block[inode->data.level1_ptr_index]);
-  }
-  else
-  {
-    block_read(fs_device, level1_block[inode->data.level1_ptr_index],
-               &level2_block);
-  }
-  while (inode->data.level2_ptr_index < PTRS_PER_SECTOR)
-  {
-    free_map_allocate(1, &level2_block[inode->data.level2_ptr_index]);
-    block_write(fs_device, level2_block[inode->data.level2_ptr_index],
-                zeros);
-    inode->data.level2_ptr_index ++;
-    needed_allocated_sectors--;
-    if (needed_allocated_sectors == 0)
+  inode->promised_cnt = promised;
+  inode_fill_holes (inode, start, end, false);
+  free_map_unreserve (inode->promised_cnt);
+  inode->promised_cnt = 0;
+}
+
+/* Fills the holes among data sectors START up to END of INODE
+   from sectors reserved in a single free map update, consecutive
+   ones if possible, using up PROMISED sectors promised by
+   free_map_reserve().  If there is no memory to hold the batch,
+   promised sectors are taken one at a time instead.  Returns
+   false, changing nothing, if the disk is too full. */
+static bool
+inode_reserve_holes (struct inode *inode, size_t start, size_t end,
+                     size_t promised)
+{
+  size_t cnt = inode_fill_holes (inode, start, end, true);
+  block_sector_t *sectors;
+
+  if (cnt == 0)
     {
-      break;
+      free_map_unreserve (promised);
+      return true;
     }
-  }
-  block_write(fs_device, level1_block[inode->data.level1_ptr_index], &level2_block);
-  if (inode->data.level2_ptr_index == PTRS_PER_SECTOR)
-  {
-    inode->data.level2_ptr_index = 0;
-    inode->data.level1_ptr_index ++;
-  }
-  return needed_allocated_sectors;
+  sectors = malloc (cnt * sizeof *sectors);
+  if (sectors == NULL && promised >= cnt)
+    {
+      inode_fill_promised (inode, start, end, promised);
+      return true;
+    }
+  if (sectors == NULL || !free_map_allocate_many (cnt, sectors, promised))
+    {
+      free (sectors);
+      return false;
+    }
+  inode->reserved = sectors;
+  inode->reserved_cnt = cnt;
+  inode_fill_holes (inode, start, end, false);
+  ASSERT (inode->reserved_cnt == 0);
+  inode->reserved = NULL;
+  free (sectors);
+  return true;
 }
 
+/* Allocates all the data sectors of DISK_INODE, which has none
+   yet, and the index blocks they need, leaving the data sectors
+   unwritten.  Returns false if the disk is too full. */
 bool allocate_inode(struct inode_disk *disk_inode)
 {
   struct inode inode = {
       .length = 0
   };
-  // memcpy();
-  inode_extend(&inode, disk_inode->length);
+  size_t cnt = bytes_to_data_sectors(disk_inode->length);
+
+  // a zero length leaves the new sectors unwritten, not zeroed
+  inode.data = *disk_inode;
+  inode.data.length = 0;
+  if (!inode_reserve_holes(&inode, 0, cnt, 0))
+  {
+    return false;
+  }
 
   // copy the disk inode
   for (int i = 0; i < TOTAL_POINTER_NUM; i++) {
     disk_inode->pointers[i] = inode.data.pointers[i];
   }
-  disk_inode->level0_ptr_index = inode.data.level0_ptr_index;
-  disk_inode->level1_ptr_index = inode.data.level1_ptr_index;
-  disk_inode->level2_ptr_index = inode.data.level2_ptr_index;
+  disk_inode->unwritten_cnt = cnt;
   return true;
 }
 
 
 void deallocate_inode(struct inode *inode)
 {
-  size_t level0_sectors = bytes_to_data_sectors(inode->length);
-  size_t level1_sectors = bytes_to_indirect_sectors(inode->length);
-  size_t level2_sectors = bytes_to_double_indirect_sector(inode->length);
-  unsigned int level0_ptr_index = 0;
-  while (level0_sectors && level0_ptr_index < DIRECT_POINTER_NUM)
+  if (!inode->data.is_inline)
   {
-    free_map_release(inode->data.pointers[level0_ptr_index], 1);
-    level0_sectors--;
-    level0_ptr_index++;
+    inode_dealloc(inode, 0, bytes_to_data_sectors(inode->length));
   }
-  if (level1_sectors)
+}
+
+/* Moves INODE's inline data out to a data sector of its own, in
+   the buffer cache, so that INODE can grow past INODE_INLINE_MAX
+   bytes.  The caller must hold INODE's extend_lock if it is a
+   file, and write INODE to disk.  Returns false, changing
+   nothing, if the disk is full. */
+static bool inode_uninline(struct inode *inode)
+{
+  uint8_t data[INODE_INLINE_MAX];
+  block_sector_t sector = 0;
+  off_t length = inode->data.length;
+
+  if (length > 0 && !free_map_allocate(1, &sector))
   {
-    size_t single_data_ptrs = level0_sectors;
-    if (single_data_ptrs > PTRS_PER_SECTOR) {
-      single_data_ptrs = PTRS_PER_SECTOR;
-    }
-    inode_dealloc_indirect_block(&inode->data.pointers[level0_ptr_index], single_data_ptrs);
-    level0_sectors -= single_data_ptrs;
-    level1_sectors --;
-    level0_ptr_index++;
+    return false;
   }
-  if (level2_sectors)
+  memcpy(data, inode->data.inline_data, sizeof data);
+  memset(inode->data.inline_data, 0, sizeof inode->data.inline_data);
+  if (length > 0)
   {
-    inode_dealloc_double_indirect_block(&inode->data.pointers[level0_ptr_index], 
-                                 level1_sectors,level0_sectors);
+    struct cache_entry *c;
+    filesys_cache_zero_block(sector, inode);
+    c = filesys_cache_get_block(sector, true);
+    memcpy(&c->block, data, length);
+    filesys_cache_mark_dirty(c, inode);
+    c->open_cnt--;
+    inode->data.pointers[0] = sector;
   }
+  inode->data.is_inline = 0;
+  inode->data.unwritten_cnt = 0;
+  return true;
 }
 
+/* Releases SECTOR, once part of an inode, and drops any cached
+   copy of it.  Does nothing for a hole. */
+static void release_sector(block_sector_t sector)
+{
+  if (sector == 0)
+  {
+    return;
+  }
+  filesys_cache_discard(sector);
+  free_map_release(sector, 1);
+}
+
+/* Frees INODE's data sectors from index START up to END, the
+   number it spans, along with the index blocks that no longer
+   point to any data, and turns their pointers into holes. */
+static void inode_dealloc(struct inode *inode, size_t start, size_t end)
+{
+  size_t double_start = DIRECT_POINTER_NUM + PTRS_PER_SECTOR;
+  size_t i;
+
+  for (i = start; i < end && i < DIRECT_POINTER_NUM; i++)
+  {
+    release_sector(inode->data.pointers[i]);
+    inode->data.pointers[i] = 0;
+  }
+  if (end > DIRECT_POINTER_NUM && start < double_start)
+  {
+    size_t lo = start > DIRECT_POINTER_NUM ? start - DIRECT_POINTER_NUM : 0;
+    size_t hi = end < double_start ? end - DIRECT_POINTER_NUM : PTRS_PER_SECTOR;
+    inode_dealloc_indirect_block(&inode->data.pointers[DIRECT_POINTER_NUM],
+                                 lo, hi);
+  }
+  if (end > double_start)
+  {
+    size_t lo = start > double_start ? start - double_start : 0;
+    inode_dealloc_double_indirect_block(
+        &inode->data.pointers[DIRECT_POINTER_NUM + SINGLE_POINTER_NUM],
+        lo, end - double_start);
+  }
+}
+
+/* Frees data pointers START up to END of the doubly indirect
+   block *PTR, and the indirect blocks and *PTR itself once they
+   point to nothing, clearing the pointers to all of them. */
 void inode_dealloc_double_indirect_block(block_sector_t *ptr,
-                                         size_t level1_sectors,
-                                         size_t level0_sectors)
+                                         size_t start, size_t end)
 {
   unsigned int i;
   block_sector_t ptr_block[PTRS_PER_SECTOR];
+  if (*ptr == 0)
+  {
+    return;
+  }
   block_read(fs_device, *ptr, &ptr_block);
-  for (i = 0; i < level1_sectors; i++)
+  for (i = start / PTRS_PER_SECTOR; i < DIV_ROUND_UP(end, PTRS_PER_SECTOR); i++)
   {
-    size_t data_per_block = PTRS_PER_SECTOR;
-    if (data_per_block > level0_sectors) {
-      data_per_block = level0_sectors;
-    }
-    inode_dealloc_indirect_block(&ptr_block[i], data_per_block);
-    level0_sectors -= data_per_block;
+    size_t base = i * PTRS_PER_SECTOR;
+    size_t lo = start > base ? start - base : 0;
+    size_t hi = end < base + PTRS_PER_SECTOR ? end - base : PTRS_PER_SECTOR;
+    inode_dealloc_indirect_block(&ptr_block[i], lo, hi);
+  }
+  if (start == 0)
+  {
+    release_sector(*ptr);
+    *ptr = 0;
+  }
+  else
+  {
+    block_write(fs_device, *ptr, &ptr_block);
   }
-  free_map_release(*ptr, 1);
 }
 
-void inode_dealloc_indirect_block(block_sector_t *ptr, size_t data_ptrs)
+/* Frees data pointers START up to END of the indirect block
+   *PTR, and *PTR itself once it points to nothing, clearing the
+   pointers to all of them. */
+void inode_dealloc_indirect_block(block_sector_t *ptr, size_t start, size_t end)
 {
   block_sector_t ptr_block[PTRS_PER_SECTOR];
+  if (*ptr == 0)
+  {
+    return;
+  }
   block_read(fs_device, *ptr, &ptr_block);
-  for (unsigned int i = 0; i < data_ptrs; i++)
+  for (unsigned int i = start; i < end; i++)
+  {
+    release_sector(ptr_block[i]);
+    ptr_block[i] = 0;
+  }
+  if (start == 0)
+  {
+    release_sector(*ptr);
+    *ptr = 0;
+  }
+  else
   {
-    free_map_release(ptr_block[i], 1);
+    block_write(fs_device, *ptr, &ptr_block);
   }
-  free_map_release(*ptr, 1);
-}
\ No newline at end of file
+}
+
+/* Allocates a sector for INODE's data or index blocks into
+   *SECTORP, from the batch reserved by inode_reserve_holes() if
+   there is one, or else out of the sectors promised to INODE by
+   inode_fill_promised(). */
+static bool inode_alloc_sector(struct inode *inode, block_sector_t *sectorp)
+{
+  if (inode->reserved != NULL)
+  {
+    ASSERT(inode->reserved_cnt > 0);
+    *sectorp = *inode->reserved++;
+    inode->reserved_cnt--;
+    return true;
+  }
+  if (inode->promised_cnt > 0)
+  {
+    if (!free_map_allocate_many(1, sectorp, 1))
+      return false;
+    inode->promised_cnt--;
+    return true;
+  }
+  return free_map_allocate(1, sectorp);
+}
+
+/* Makes sure all the data sectors of INODE holding bytes START
+   up to END, and the index blocks that lead to them, are
+   allocated, extending INODE to END bytes if it is shorter.  All
+   the sectors needed are reserved in a single free map update.
+   Holes filled inside the old length are zeroed in the cache,
+   and new sectors past it are left unwritten, to read as zeros;
+   so that they stay at the tail, extending also fills whatever
+   lies between the old end and START.
+   Returns false, changing nothing, if the disk is too full. */
+bool
+inode_allocate (struct inode *inode, off_t start, off_t end)
+{
+  size_t old_cnt, new_cnt, first;
+
+  if (inode->deny_write_cnt || end > MAX_FILE_SIZE)
+    return false;
+  if (start >= end)
+    return true;
+  lock_acquire (&inode->extend_lock);
+  if (inode->data.is_inline && end <= INODE_INLINE_MAX)
+    {
+      /* inline data past the old length is already zeros */
+      if (end > inode_length (inode))
+        {
+          inode->length = inode->data.length = end;
+          inode->length_for_read = end;
+          block_write (fs_device, inode->sector, &inode->data);
+        }
+      lock_release (&inode->extend_lock);
+      return true;
+    }
+  if (inode->data.is_inline && !inode_uninline (inode))
+    {
+      lock_release (&inode->extend_lock);
+      return false;
+    }
+  inode_place_delayed (inode);
+  old_cnt = bytes_to_data_sectors (inode->length);
+  new_cnt = bytes_to_data_sectors (end);
+  first = start / BLOCK_SECTOR_SIZE;
+  if (end > inode_length (inode) && first > old_cnt)
+    first = old_cnt;
+  if (!inode_reserve_holes (inode, first, new_cnt, 0))
+    {
+      lock_release (&inode->extend_lock);
+      return false;
+    }
+  if (end > inode_length (inode))
+    {
+      inode->data.unwritten_cnt += new_cnt - old_cnt;
+      inode->length = inode->data.length = end;
+      inode->length_for_read = end;
+    }
+  block_write (fs_device, inode->sector, &inode->data);
+  lock_release (&inode->extend_lock);
+  return true;
+}
+
+/* Sets INODE's length to LENGTH bytes.  Shrinking frees the data
+   sectors past the new end and the index blocks left empty;
+   growing leaves a hole.  Returns false if INODE cannot be
+   written or LENGTH is too large. */
+bool
+inode_truncate (struct inode *inode, off_t length)
+{
+  size_t old_cnt, new_cnt, first;
+
+  if (inode->deny_write_cnt || length > MAX_FILE_SIZE)
+    return false;
+
+  lock_acquire (&inode->extend_lock);
+  if (inode->data.is_inline && length > INODE_INLINE_MAX
+      && !inode_uninline (inode))
+    {
+      lock_release (&inode->extend_lock);
+      return false;
+    }
+  inode_place_delayed (inode);
+  if (inode->data.is_inline)
+    {
+      /* keep the bytes past the end zero, to read as such if
+         the data grows again */
+      if (length < inode_length (inode))
+        memset (inode->data.inline_data + length, 0,
+                inode_length (inode) - length);
+      inode->length = inode->data.length = length;
+      inode->length_for_read = length;
+      block_write (fs_device, inode->sector, &inode->data);
+      lock_release (&inode->extend_lock);
+      return true;
+    }
+  if (length >= inode_length (inode))
+    {
+      /* unwritten sectors must stay at the tail */
+      inode_fill_unwritten (inode, inode->length);
+      inode->length = inode->data.length = length;
+      inode->length_for_read = length;
+      block_write (fs_device, inode->sector, &inode->data);
+      lock_release (&inode->extend_lock);
+      return true;
+    }
+  old_cnt = bytes_to_data_sectors (inode->length);
+  new_cnt = bytes_to_data_sectors (length);
+  first = first_unwritten (inode);
+
+  /* Zero the rest of the new last sector, so that growing the
+     file again shows zeros there, not the old data. */
+  if (length % BLOCK_SECTOR_SIZE != 0
+      && (size_t) (length / BLOCK_SECTOR_SIZE) < first
+      && byte_to_sector (inode, length) != 0)
+    {
+      int ofs = length % BLOCK_SECTOR_SIZE;
+      struct cache_entry *c
+        = filesys_cache_get_block (byte_to_sector (inode, length), true);
+      memset ((uint8_t *) &c->block + ofs, 0, BLOCK_SECTOR_SIZE - ofs);
+      filesys_cache_mark_dirty (c, inode);
+      c->open_cnt--;
+    }
+
+  /* Readers check length_for_read under extend_lock before
+     looking up a sector, so none can reach those freed here. */
+  inode->length_for_read = length;
+  inode_dealloc (inode, new_cnt, old_cnt);
+  inode->data.unwritten_cnt = first < new_cnt ? new_cnt - first : 0;
+  inode->length = inode->data.length = length;
+  block_write (fs_device, inode->sector, &inode->data);
+  lock_release (&inode->extend_lock);
+  return true;
+}
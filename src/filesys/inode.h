@@ -19,8 +19,11 @@
 
 #define MAX_FILE_SIZE 8460288 // in bytes
 #define PTRS_PER_SECTOR 128 // how many sectors a block can point: 512 byte / 4 byte
+#define INODE_INLINE_MAX 492 // bytes of data an inode sector can hold itself
+#define DELAYED_RUN_MAX 32 // appended blocks an inode holds before allocating them
 
 struct bitmap;
+struct cache_entry;
 
 /* On-disk inode.
    Must be exactly BLOCK_SECTOR_SIZE bytes long. */
@@ -29,14 +32,15 @@ struct inode_disk
     // block_sector_t start;               /* First data sector. */
     off_t length;                       /* File size in bytes. */
     unsigned magic;                     /* Magic number. */
-     
-    block_sector_t pointers[TOTAL_POINTER_NUM];
-    uint32_t level0_ptr_index;                  /* index of the pointer list */
-    uint32_t level1_ptr_index;               /* index of the level 1 pointer table */
-    uint32_t level2_ptr_index;               /* index of the level 2 pointer table */
-
     uint32_t is_file;                    /* 1 for file, 0 for dir */
-    uint32_t not_used[122 - TOTAL_POINTER_NUM];
+    uint32_t unwritten_cnt;              /* last data sectors never written */
+    uint32_t is_inline;                  /* 1 if the data is in inline_data */
+
+    union
+      {
+        block_sector_t pointers[TOTAL_POINTER_NUM]; /* 0 for a hole */
+        uint8_t inline_data[INODE_INLINE_MAX];  /* zeros past length */
+      };
   };
 
 
@@ -56,8 +60,22 @@ struct inode
     off_t length;                       /* File size in bytes. */
     off_t length_for_read; 
 
+    struct list dirty_sectors;          /* Cache entries written, for fsync. */
+    int advice;                         /* Access pattern, an ADVICE_*. */
+    bool noreuse;                       /* Demote sectors after use? */
+
+    block_sector_t *reserved;           /* Sectors for filling holes, */
+    size_t reserved_cnt;                /* ...and how many are left, */
+    size_t promised_cnt;                /* ...or promised, if none. */
+
+    struct cache_entry *delayed[DELAYED_RUN_MAX]; /* Appended blocks, */
+    size_t delayed_start;               /* ...the first one's index, */
+    size_t delayed_cnt;                 /* ...how many there are, */
+    size_t delayed_promised;            /* ...and free sectors promised. */
+
   };
 void inode_init (void);
+void inode_flush_all_delayed (void);
 
 struct node* inode_cache_create (block_sector_t sector, uint32_t is_file);
 bool inode_create (block_sector_t sector, off_t length, uint32_t is_file);
@@ -69,6 +87,12 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_copy_range (struct inode *in, off_t in_ofs,
+                        struct inode *out, off_t out_ofs, off_t size);
+void inode_sync (struct inode *, bool data_only);
+void inode_advise (struct inode *, off_t offset, off_t len, int advice);
+bool inode_allocate (struct inode *, off_t start, off_t end);
+bool inode_truncate (struct inode *, off_t length);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
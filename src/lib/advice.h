@@ -0,0 +1,18 @@
+#ifndef __LIB_ADVICE_H
+#define __LIB_ADVICE_H
+
+/* Hints about how a file will be accessed, given to the kernel
+   with the advise system call.  The first four describe the
+   access pattern of the whole file; WILLNEED and DONTNEED act
+   once, on the range given with them. */
+enum advice
+  {
+    ADVICE_NORMAL,              /* No particular pattern; the default. */
+    ADVICE_SEQUENTIAL,          /* Read in order: read ahead further. */
+    ADVICE_RANDOM,              /* Read in no order: don't read ahead. */
+    ADVICE_NOREUSE,             /* Used once: cache it only briefly. */
+    ADVICE_WILLNEED,            /* Needed soon: start reading it now. */
+    ADVICE_DONTNEED             /* Not needed soon: evict it first. */
+  };
+
+#endif /* lib/advice.h */
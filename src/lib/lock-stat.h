@@ -0,0 +1,27 @@
+#ifndef __LIB_LOCK_STAT_H
+#define __LIB_LOCK_STAT_H
+
+#include <stdint.h>
+
+/* Number of buckets in a lock's wait-time histogram.  Bucket 0
+   counts waits of 0 ticks, bucket B for 0 < B < LOCK_STAT_BUCKETS
+   - 1 waits of 2**(B-1) to 2**B - 1 ticks, and the last bucket
+   all longer waits. */
+#define LOCK_STAT_BUCKETS 6
+
+/* Contention statistics for one lock, as gathered by the kernel's
+   lock profiler (kernel command-line option "-lockprof") and
+   returned by the lock_stat system call. */
+struct lock_stat
+  {
+    char name[16];                      /* Name of the lock. */
+    uint32_t acquired;                  /* # of acquisitions. */
+    uint32_t contended;                 /* # that had to wait. */
+    uint32_t wait_ticks;                /* Total ticks spent waiting. */
+    uint32_t max_wait_ticks;            /* Longest wait, in ticks. */
+    uint32_t hold_ticks;                /* Total ticks held. */
+    uint32_t max_hold_ticks;            /* Longest hold, in ticks. */
+    uint32_t wait_hist[LOCK_STAT_BUCKETS]; /* Waits by length. */
+  };
+
+#endif /* lib/lock-stat.h */
@@ -31,6 +31,20 @@ enum
     SYS_INUMBER,                /* Returns the inode number for a fd. */
 
     SYS_CACHE_FLUSH,            /* Flash cache to the disk, return the flash number*/
+    SYS_GET_TICKS,              /* Timer ticks since boot, for benchmarks. */
+    SYS_LOCK_STAT,              /* Lock profiler statistics. */
+    SYS_GETDENTS,               /* Reads many directory entries. */
+    SYS_PREAD,                  /* Reads at an offset. */
+    SYS_PWRITE,                 /* Writes at an offset. */
+    SYS_READV,                  /* Reads into many buffers. */
+    SYS_WRITEV,                 /* Writes from many buffers. */
+    SYS_COPY_FILE_RANGE,        /* Copies between files in the kernel. */
+    SYS_RING_ENTER,             /* Runs operations queued on a ring. */
+    SYS_FSYNC,                  /* Writes a file's data and inode to disk. */
+    SYS_FDATASYNC,              /* Writes a file's data to disk. */
+    SYS_ADVISE,                 /* Hints how a file will be accessed. */
+    SYS_FALLOCATE,              /* Reserves disk space for a file. */
+    SYS_FTRUNCATE,              /* Changes the length of a file. */
   };
 
 #endif /* lib/syscall-nr.h */
@@ -2,7 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <debug.h>
+#include <lock-stat.h>
+#include <advice.h>
 
 /* Process identifier. */
 typedef int pid_t;
@@ -15,6 +18,70 @@ typedef int mapid_t;
 /* Maximum characters in a filename written by readdir(). */
 #define READDIR_MAX_LEN 14
 
+/* A directory entry, as written by getdents(). */
+struct dirent
+  {
+    int inumber;                        /* Inode number. */
+    bool is_dir;                        /* Directory or ordinary file? */
+    char name[READDIR_MAX_LEN + 1];     /* Null-terminated name. */
+  };
+
+/* A buffer for readv() and writev(). */
+struct iovec
+  {
+    void *iov_base;                     /* Start of buffer. */
+    size_t iov_len;                     /* Length of buffer in bytes. */
+  };
+
+/* Maximum number of buffers passed to readv() or writev(). */
+#define IOV_MAX 64
+
+/* Operations that can be queued on a submission ring. */
+enum ring_op
+  {
+    RING_OP_NOP,                /* Does nothing; completes with 0. */
+    RING_OP_OPEN,               /* open (buf). */
+    RING_OP_CLOSE,              /* close (fd); completes with 0. */
+    RING_OP_READ,               /* read or pread into buf. */
+    RING_OP_WRITE               /* write or pwrite from buf. */
+  };
+
+/* A queued operation.  A negative OFFSET reads or writes at the
+   file position and advances it, like read() and write(). */
+struct ring_sqe
+  {
+    int op;                             /* A RING_OP_* value. */
+    int fd;                             /* File descriptor. */
+    void *buf;                          /* Buffer or file name. */
+    unsigned len;                       /* Length of BUF in bytes. */
+    int offset;                         /* File offset, or -1. */
+    unsigned user_data;                 /* Copied to the completion. */
+  };
+
+/* The result of a finished operation, as its system call would
+   have returned it. */
+struct ring_cqe
+  {
+    unsigned user_data;                 /* From the ring_sqe. */
+    int result;                         /* Return value. */
+  };
+
+/* Number of entries in each queue of a ring. */
+#define RING_ENTRIES 64
+
+/* A pair of queues shared with the kernel.  The process adds
+   operations at SQ_TAIL and the kernel takes them from SQ_HEAD;
+   the kernel adds completions at CQ_TAIL and the process takes
+   them from CQ_HEAD.  Indexes only grow and are taken modulo
+   RING_ENTRIES.  Zero-initialize before first use. */
+struct ring
+  {
+    unsigned sq_head, sq_tail;
+    unsigned cq_head, cq_tail;
+    struct ring_sqe sq[RING_ENTRIES];
+    struct ring_cqe cq[RING_ENTRIES];
+  };
+
 /* Typical return values from main() and arguments to exit(). */
 #define EXIT_SUCCESS 0          /* Successful execution. */
 #define EXIT_FAILURE 1          /* Unsuccessful execution. */
@@ -33,6 +100,18 @@ int write (int fd, const void *buffer, unsigned length);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
+int pread (int fd, void *buffer, unsigned length, unsigned offset);
+int pwrite (int fd, const void *buffer, unsigned length, unsigned offset);
+int readv (int fd, const struct iovec *, int iovcnt);
+int writev (int fd, const struct iovec *, int iovcnt);
+int copy_file_range (int fd_in, int off_in, int fd_out, int off_out,
+                     unsigned length);
+int ring_enter (struct ring *, unsigned to_submit);
+int fsync (int fd);
+int fdatasync (int fd);
+int advise (int fd, unsigned offset, unsigned length, enum advice);
+int fallocate (int fd, unsigned offset, unsigned length);
+int ftruncate (int fd, unsigned length);
 
 /* Project 3 and optionally project 4. */
 mapid_t mmap (int fd, void *addr);
@@ -44,7 +123,10 @@ bool mkdir (const char *dir);
 bool readdir (int fd, char name[READDIR_MAX_LEN + 1]);
 bool isdir (int fd);
 int inumber (int fd);
+int getdents (int fd, struct dirent *, int count);
 
 int cache_flush (void);
+int get_ticks (void);
+bool lock_stat (int index, struct lock_stat *);
 
 #endif /* lib/user/syscall.h */
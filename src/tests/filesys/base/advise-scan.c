@@ -0,0 +1,79 @@
+/* Streams once through a large log file while re-reading a small
+   hot file, the way a lookup-heavy workload runs next to a scan.
+   The pass is timed twice: with no advice, and with the log
+   advised SEQUENTIAL and NOREUSE, so that its sectors are
+   evicted before the hot file's. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LOG_SIZE (192 * 512)
+#define HOT_SIZE (16 * 512)
+#define BLOCK_SIZE 512
+#define HOT_EVERY 8             /* Log blocks per hot file pass. */
+
+static char log_data[LOG_SIZE];
+static char hot_data[HOT_SIZE];
+static char block[BLOCK_SIZE];
+
+/* Reads all of LOG_FD, checking its contents, and every
+   HOT_EVERY blocks all of HOT_FD.  Returns the ticks taken. */
+static int
+scan (int log_fd, int hot_fd)
+{
+  int start = get_ticks ();
+  int ofs, hot_ofs;
+
+  for (ofs = 0; ofs < LOG_SIZE; ofs += BLOCK_SIZE)
+    {
+      if (pread (log_fd, block, BLOCK_SIZE, ofs) != BLOCK_SIZE
+          || memcmp (block, log_data + ofs, BLOCK_SIZE))
+        fail ("read of \"log\" at %d failed", ofs);
+      if (ofs / BLOCK_SIZE % HOT_EVERY == 0)
+        for (hot_ofs = 0; hot_ofs < HOT_SIZE; hot_ofs += BLOCK_SIZE)
+          if (pread (hot_fd, block, BLOCK_SIZE, hot_ofs) != BLOCK_SIZE
+              || memcmp (block, hot_data + hot_ofs, BLOCK_SIZE))
+            fail ("read of \"hot\" at %d failed", hot_ofs);
+    }
+  return get_ticks () - start;
+}
+
+void
+test_main (void)
+{
+  int log_fd, hot_fd;
+  int ticks;
+
+  random_init (0);
+  random_bytes (log_data, sizeof log_data);
+  random_bytes (hot_data, sizeof hot_data);
+  CHECK (create ("log", 0), "create \"log\"");
+  CHECK (create ("hot", 0), "create \"hot\"");
+  CHECK ((log_fd = open ("log")) > 1, "open \"log\"");
+  CHECK ((hot_fd = open ("hot")) > 1, "open \"hot\"");
+  CHECK (write (log_fd, log_data, LOG_SIZE) == LOG_SIZE, "write \"log\"");
+  CHECK (write (hot_fd, hot_data, HOT_SIZE) == HOT_SIZE, "write \"hot\"");
+
+  msg ("scan without advice");
+  ticks = scan (log_fd, hot_fd);
+  msg ("plain: %d ticks", ticks);
+
+  CHECK (advise (log_fd, 0, 0, ADVICE_DONTNEED) == 0, "advise DONTNEED");
+  CHECK (advise (log_fd, 0, 0, ADVICE_SEQUENTIAL) == 0,
+         "advise SEQUENTIAL");
+  CHECK (advise (log_fd, 0, 0, ADVICE_NOREUSE) == 0, "advise NOREUSE");
+  CHECK (advise (hot_fd, 0, 0, ADVICE_WILLNEED) == 0, "advise WILLNEED");
+  CHECK (advise (hot_fd, 0, 0, 99) == -1, "advise bad hint");
+
+  msg ("scan with advice");
+  ticks = scan (log_fd, hot_fd);
+  msg ("advised: %d ticks", ticks);
+
+  msg ("close \"log\"");
+  close (log_fd);
+  msg ("close \"hot\"");
+  close (hot_fd);
+}
@@ -0,0 +1,28 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(advise-scan\) \w+: \d+ ticks$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(advise-scan) begin
+(advise-scan) create "log"
+(advise-scan) create "hot"
+(advise-scan) open "log"
+(advise-scan) open "hot"
+(advise-scan) write "log"
+(advise-scan) write "hot"
+(advise-scan) scan without advice
+(advise-scan) advise DONTNEED
+(advise-scan) advise SEQUENTIAL
+(advise-scan) advise NOREUSE
+(advise-scan) advise WILLNEED
+(advise-scan) advise bad hint
+(advise-scan) scan with advice
+(advise-scan) close "log"
+(advise-scan) close "hot"
+(advise-scan) end
+EOF
+pass;
@@ -0,0 +1,22 @@
+/* Child process for exec-rate test.
+   Touches a few pages of data, so that the kernel has an address
+   space of realistic size to tear down, and exits. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+
+const char *test_name = "child-exit";
+
+#define TOUCH_PAGES 16
+
+static char pages[TOUCH_PAGES][4096];
+
+int
+main (void)
+{
+  int i;
+
+  for (i = 0; i < TOUCH_PAGES; i++)
+    pages[i][0] = i;
+  return 0;
+}
@@ -0,0 +1,56 @@
+/* Copies a large file with a single copy_file_range() call into
+   an empty file, then copies an unaligned range between offsets,
+   and checks that an overlapping copy within one file fails. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE 75678
+#define PART_OFS 1000
+#define PART_SIZE 5000
+#define PART_DST 333
+
+static char buf[TEST_SIZE];
+static char part[PART_DST + PART_SIZE];
+
+void
+test_main (void)
+{
+  int src_fd, dst_fd;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("src", 0), "create \"src\"");
+  CHECK ((src_fd = open ("src")) > 1, "open \"src\"");
+  CHECK (write (src_fd, buf, sizeof buf) == sizeof buf, "write \"src\"");
+  seek (src_fd, 0);
+
+  CHECK (create ("dst", 0), "create \"dst\"");
+  CHECK ((dst_fd = open ("dst")) > 1, "open \"dst\"");
+  CHECK (copy_file_range (src_fd, -1, dst_fd, -1, sizeof buf) == sizeof buf,
+         "copy \"src\" to \"dst\"");
+  CHECK (tell (src_fd) == sizeof buf && tell (dst_fd) == sizeof buf,
+         "file positions advanced");
+  CHECK (copy_file_range (src_fd, -1, dst_fd, -1, sizeof buf) == 0,
+         "copy at end of \"src\"");
+  close (dst_fd);
+  check_file ("dst", buf, sizeof buf);
+
+  CHECK (create ("part", 0), "create \"part\"");
+  CHECK ((dst_fd = open ("part")) > 1, "open \"part\"");
+  CHECK (copy_file_range (src_fd, PART_OFS, dst_fd, PART_DST, PART_SIZE)
+         == PART_SIZE, "copy part of \"src\" to \"part\"");
+  CHECK (tell (dst_fd) == 0, "file position unchanged");
+  close (dst_fd);
+  memcpy (part + PART_DST, buf + PART_OFS, PART_SIZE);
+  check_file ("part", part, sizeof part);
+
+  CHECK (copy_file_range (src_fd, 0, src_fd, 100, 1000) == -1,
+         "overlapping copy within \"src\" fails");
+  msg ("close \"src\"");
+  close (src_fd);
+}
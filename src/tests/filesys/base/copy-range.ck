@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(copy-range) begin
+(copy-range) create "src"
+(copy-range) open "src"
+(copy-range) write "src"
+(copy-range) create "dst"
+(copy-range) open "dst"
+(copy-range) copy "src" to "dst"
+(copy-range) file positions advanced
+(copy-range) copy at end of "src"
+(copy-range) open "dst" for verification
+(copy-range) verified contents of "dst"
+(copy-range) close "dst"
+(copy-range) create "part"
+(copy-range) open "part"
+(copy-range) copy part of "src" to "part"
+(copy-range) file position unchanged
+(copy-range) open "part" for verification
+(copy-range) verified contents of "part"
+(copy-range) close "part"
+(copy-range) overlapping copy within "src" fails
+(copy-range) close "src"
+(copy-range) end
+EOF
+pass;
@@ -0,0 +1,67 @@
+/* Appends to a log file in small writes, reading each one back
+   before it can have reached the disk, and does the same to a
+   temporary file that is removed before the cache is flushed.
+   The log's sectors are only allocated when it is flushed, in
+   one run; the temporary file's never are. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define LOG_SIZE (48 * 512)
+#define APPEND_SIZE 100
+
+static char log_data[LOG_SIZE];
+static char buf[LOG_SIZE];
+
+/* Appends all of log_data to FD, APPEND_SIZE bytes at a time,
+   reading each append back.  Returns the ticks taken. */
+static int
+append_all (int fd, const char *name)
+{
+  int start = get_ticks ();
+  int ofs;
+
+  for (ofs = 0; ofs < LOG_SIZE; ofs += APPEND_SIZE)
+    {
+      int size = LOG_SIZE - ofs < APPEND_SIZE ? LOG_SIZE - ofs : APPEND_SIZE;
+      if (write (fd, log_data + ofs, size) != size)
+        fail ("append to \"%s\" at %d failed", name, ofs);
+      if (pread (fd, buf, size, ofs) != size
+          || memcmp (buf, log_data + ofs, size))
+        fail ("read back of \"%s\" at %d failed", name, ofs);
+    }
+  return get_ticks () - start;
+}
+
+void
+test_main (void)
+{
+  int log_fd, tmp_fd;
+  int ticks;
+
+  random_init (0);
+  random_bytes (log_data, sizeof log_data);
+  CHECK (create ("log", 0), "create \"log\"");
+  CHECK (create ("tmp", 0), "create \"tmp\"");
+  CHECK ((log_fd = open ("log")) > 1, "open \"log\"");
+  CHECK ((tmp_fd = open ("tmp")) > 1, "open \"tmp\"");
+
+  msg ("append to \"log\" and \"tmp\"");
+  ticks = append_all (log_fd, "log");
+  ticks += append_all (tmp_fd, "tmp");
+  msg ("append: %d ticks", ticks);
+
+  CHECK (remove ("tmp"), "remove \"tmp\"");
+  msg ("close \"tmp\"");
+  close (tmp_fd);
+  msg ("flush: %d blocks written", cache_flush ());
+
+  CHECK (pread (log_fd, buf, LOG_SIZE, 0) == LOG_SIZE, "read \"log\"");
+  if (memcmp (buf, log_data, LOG_SIZE))
+    fail ("\"log\" has wrong contents");
+  msg ("close \"log\"");
+  close (log_fd);
+}
@@ -0,0 +1,32 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The flush writes the 48 sectors of "log" and the free map's 1,
+# or fewer if the periodic write-back got to some first, but none
+# of removed "tmp".
+my ($flushed) = map (/^\(delay-append\) flush: (\d+) blocks written$/,
+                     @output);
+fail "No flush count found in output.\n" if !defined $flushed;
+fail "Flush wrote $flushed blocks, more than the 49 of \"log\" "
+  . "and the free map: data of removed \"tmp\" reached the disk.\n"
+  if $flushed > 49;
+@output = grep (!/^\(delay-append\) (append: \d+ ticks|flush: \d+ blocks written)$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(delay-append) begin
+(delay-append) create "log"
+(delay-append) create "tmp"
+(delay-append) open "log"
+(delay-append) open "tmp"
+(delay-append) append to "log" and "tmp"
+(delay-append) remove "tmp"
+(delay-append) close "tmp"
+(delay-append) read "log"
+(delay-append) close "log"
+(delay-append) end
+EOF
+pass;
@@ -0,0 +1,50 @@
+/* Measures process creation and teardown throughput.  Runs a
+   short-lived child over and over, first one at a time and then
+   in groups that run concurrently, timing how long each pass
+   takes with exec(), wait(), and the child's exit. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SERIAL_CNT 100
+#define GROUP_CNT 10
+#define GROUP_SIZE 8
+
+static void
+wait_for (pid_t pid)
+{
+  int status = wait (pid);
+  if (status != 0)
+    fail ("wait for child %d returned %d", pid, status);
+}
+
+void
+test_main (void)
+{
+  pid_t pids[GROUP_SIZE];
+  int start;
+  int i, j;
+
+  start = get_ticks ();
+  for (i = 0; i < SERIAL_CNT; i++)
+    {
+      pid_t pid = exec ("child-exit");
+      if (pid == PID_ERROR)
+        fail ("exec child %d failed", i);
+      wait_for (pid);
+    }
+  msg ("serial: %d children in %d ticks", SERIAL_CNT, get_ticks () - start);
+
+  start = get_ticks ();
+  for (i = 0; i < GROUP_CNT; i++)
+    {
+      for (j = 0; j < GROUP_SIZE; j++)
+        if ((pids[j] = exec ("child-exit")) == PID_ERROR)
+          fail ("exec child %d failed", i * GROUP_SIZE + j);
+      for (j = 0; j < GROUP_SIZE; j++)
+        wait_for (pids[j]);
+    }
+  msg ("grouped: %d children in %d ticks",
+       GROUP_CNT * GROUP_SIZE, get_ticks () - start);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^child-exit: exit\(0\)$/, @output);
+@output = grep (!/^\(exec-rate\) \w+: \d+ children in \d+ ticks$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(exec-rate) begin
+(exec-rate) end
+EOF
+pass;
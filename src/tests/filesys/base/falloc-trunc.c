@@ -0,0 +1,55 @@
+/* Preallocates a file, checks that the reserved space reads back
+   as zeros, then shrinks and regrows it and checks that the cut
+   tail does not come back. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (64 * 512)
+#define MID 10000
+
+static char buf[FILE_SIZE];
+static char zeros[FILE_SIZE];
+static char data[1000];
+
+void
+test_main (void)
+{
+  int fd;
+
+  random_init (0);
+  random_bytes (data, sizeof data);
+  CHECK (create ("f", 0), "create \"f\"");
+  CHECK ((fd = open ("f")) > 1, "open \"f\"");
+
+  CHECK (fallocate (fd, 0, FILE_SIZE) == 0, "fallocate %d bytes", FILE_SIZE);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize is %d", FILE_SIZE);
+  CHECK (pread (fd, buf, FILE_SIZE, 0) == FILE_SIZE, "read \"f\"");
+  if (memcmp (buf, zeros, FILE_SIZE))
+    fail ("preallocated data is not zero");
+
+  CHECK (pwrite (fd, data, sizeof data, MID) == sizeof data,
+         "write %zu bytes at %d", sizeof data, MID);
+  CHECK (pread (fd, buf, FILE_SIZE, 0) == FILE_SIZE, "read \"f\"");
+  if (memcmp (buf, zeros, MID)
+      || memcmp (buf + MID, data, sizeof data)
+      || memcmp (buf + MID + sizeof data, zeros,
+                 FILE_SIZE - MID - sizeof data))
+    fail ("data read back does not match");
+
+  CHECK (ftruncate (fd, MID + 100) == 0, "ftruncate to %d", MID + 100);
+  CHECK (filesize (fd) == MID + 100, "filesize is %d", MID + 100);
+  CHECK (ftruncate (fd, FILE_SIZE) == 0, "ftruncate to %d", FILE_SIZE);
+  CHECK (pread (fd, buf, FILE_SIZE, 0) == FILE_SIZE, "read \"f\"");
+  if (memcmp (buf + MID, data, 100)
+      || memcmp (buf + MID + 100, zeros, FILE_SIZE - MID - 100))
+    fail ("truncated tail came back");
+
+  CHECK (fallocate (-1, 0, 512) == -1, "fallocate bad fd");
+  CHECK (ftruncate (-1, 0) == -1, "ftruncate bad fd");
+  msg ("close \"f\"");
+  close (fd);
+}
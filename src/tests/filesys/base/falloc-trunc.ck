@@ -0,0 +1,23 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(falloc-trunc) begin
+(falloc-trunc) create "f"
+(falloc-trunc) open "f"
+(falloc-trunc) fallocate 32768 bytes
+(falloc-trunc) filesize is 32768
+(falloc-trunc) read "f"
+(falloc-trunc) write 1000 bytes at 10000
+(falloc-trunc) read "f"
+(falloc-trunc) ftruncate to 10100
+(falloc-trunc) filesize is 10100
+(falloc-trunc) ftruncate to 32768
+(falloc-trunc) read "f"
+(falloc-trunc) fallocate bad fd
+(falloc-trunc) ftruncate bad fd
+(falloc-trunc) close "f"
+(falloc-trunc) end
+EOF
+pass;
@@ -0,0 +1,43 @@
+/* Dirties two files, syncs one of them, and checks with a full
+   cache flush that only the other file's sectors were left
+   dirty. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_CNT 4
+
+static char buf[SECTOR_CNT * 512];
+
+void
+test_main (void)
+{
+  int a, b;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("a", sizeof buf), "create \"a\"");
+  CHECK (create ("b", sizeof buf), "create \"b\"");
+  CHECK ((a = open ("a")) > 1, "open \"a\"");
+  CHECK ((b = open ("b")) > 1, "open \"b\"");
+  cache_flush ();
+
+  CHECK (write (a, buf, sizeof buf) == sizeof buf, "write \"a\"");
+  CHECK (write (b, buf, sizeof buf) == sizeof buf, "write \"b\"");
+  CHECK (fdatasync (a) == 0, "fdatasync \"a\"");
+  CHECK (cache_flush () == SECTOR_CNT, "only \"b\" was left dirty");
+
+  CHECK (pwrite (a, buf, sizeof buf, 0) == sizeof buf, "rewrite \"a\"");
+  CHECK (pwrite (b, buf, sizeof buf, 0) == sizeof buf, "rewrite \"b\"");
+  CHECK (fsync (b) == 0, "fsync \"b\"");
+  CHECK (cache_flush () == SECTOR_CNT, "only \"a\" was left dirty");
+
+  CHECK (fsync (a) == 0 && fsync (b) == 0, "fsync clean files");
+  CHECK (fsync (-1) == -1, "fsync bad fd");
+  msg ("close \"a\"");
+  close (a);
+  msg ("close \"b\"");
+  close (b);
+}
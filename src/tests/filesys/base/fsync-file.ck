@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(fsync-file) begin
+(fsync-file) create "a"
+(fsync-file) create "b"
+(fsync-file) open "a"
+(fsync-file) open "b"
+(fsync-file) write "a"
+(fsync-file) write "b"
+(fsync-file) fdatasync "a"
+(fsync-file) only "b" was left dirty
+(fsync-file) rewrite "a"
+(fsync-file) rewrite "b"
+(fsync-file) fsync "b"
+(fsync-file) only "a" was left dirty
+(fsync-file) fsync clean files
+(fsync-file) fsync bad fd
+(fsync-file) close "a"
+(fsync-file) close "b"
+(fsync-file) end
+EOF
+pass;
@@ -0,0 +1,99 @@
+/* Builds a small tree of directories holding tiny files, whose
+   contents all fit in their inode sectors, and reports the
+   sectors the buffer cache then has to write back and the ticks
+   taken.  Then grows a file and a directory past what an inode
+   holds and checks that nothing is lost on the way. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define DIR_CNT 4
+#define FILE_CNT 8              /* Files per directory. */
+#define SMALL_SIZE 100
+#define BIG_SIZE 1500
+#define WIDE_CNT 40             /* Entries in the widened directory. */
+
+static char data[BIG_SIZE];
+static char buf[BIG_SIZE];
+
+void
+test_main (void)
+{
+  char name[32];
+  int start, flushed;
+  int fd, i, j;
+
+  random_init (0);
+  random_bytes (data, sizeof data);
+  cache_flush ();
+
+  start = get_ticks ();
+  for (i = 0; i < DIR_CNT; i++)
+    {
+      snprintf (name, sizeof name, "d%d", i);
+      if (!mkdir (name))
+        fail ("mkdir \"%s\" failed", name);
+      for (j = 0; j < FILE_CNT; j++)
+        {
+          snprintf (name, sizeof name, "d%d/f%d", i, j);
+          if (!create (name, 0) || (fd = open (name)) < 2)
+            fail ("create \"%s\" failed", name);
+          if (write (fd, data, SMALL_SIZE) != SMALL_SIZE)
+            fail ("write \"%s\" failed", name);
+          close (fd);
+        }
+    }
+  flushed = cache_flush ();
+  msg ("tree: %d ticks", get_ticks () - start);
+  msg ("flush: %d sectors", flushed);
+  msg ("built %d directories of %d files", DIR_CNT, FILE_CNT);
+
+  CHECK ((fd = open ("d0/f0")) > 1, "open \"d0/f0\"");
+  CHECK (read (fd, buf, BIG_SIZE) == SMALL_SIZE, "read \"d0/f0\"");
+  if (memcmp (buf, data, SMALL_SIZE))
+    fail ("\"d0/f0\" has the wrong contents");
+  CHECK (write (fd, data + SMALL_SIZE, BIG_SIZE - SMALL_SIZE)
+         == BIG_SIZE - SMALL_SIZE, "grow \"d0/f0\" to %d bytes", BIG_SIZE);
+  CHECK (pread (fd, buf, BIG_SIZE, 0) == BIG_SIZE, "read \"d0/f0\"");
+  if (memcmp (buf, data, BIG_SIZE))
+    fail ("\"d0/f0\" has the wrong contents after growing");
+  msg ("close \"d0/f0\"");
+  close (fd);
+
+  CHECK ((fd = open ("d0/f1")) > 1, "open \"d0/f1\"");
+  CHECK (ftruncate (fd, 10) == 0 && ftruncate (fd, SMALL_SIZE) == 0,
+         "shrink and regrow \"d0/f1\"");
+  CHECK (pread (fd, buf, BIG_SIZE, 0) == SMALL_SIZE, "read \"d0/f1\"");
+  for (i = 10; i < SMALL_SIZE; i++)
+    if (buf[i] != 0)
+      fail ("byte %d of \"d0/f1\" is not zero", i);
+  msg ("close \"d0/f1\"");
+  close (fd);
+
+  for (i = 0; i < WIDE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "d1/w%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+  msg ("created %d more files in \"d1\"", WIDE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "d1/f%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  for (i = 0; i < WIDE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "d1/w%d", i);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\" failed", name);
+      close (fd);
+    }
+  msg ("all files in \"d1\" found");
+}
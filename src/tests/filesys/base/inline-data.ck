@@ -0,0 +1,25 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(inline-data\) \w+: \d+ (ticks|sectors)$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(inline-data) begin
+(inline-data) built 4 directories of 8 files
+(inline-data) open "d0/f0"
+(inline-data) read "d0/f0"
+(inline-data) grow "d0/f0" to 1500 bytes
+(inline-data) read "d0/f0"
+(inline-data) close "d0/f0"
+(inline-data) open "d0/f1"
+(inline-data) shrink and regrow "d0/f1"
+(inline-data) read "d0/f1"
+(inline-data) close "d0/f1"
+(inline-data) created 40 more files in "d1"
+(inline-data) all files in "d1" found
+(inline-data) end
+EOF
+pass;
@@ -0,0 +1,77 @@
+/* Writes out the same file as lg-seq-random, in the same
+   random-sized blocks, but hands the blocks to writev() in
+   batches, then reads it back with pread() to verify it.
+   Reports how many system calls each approach needed. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define TEST_SIZE 75678
+#define BATCH 16
+
+static char buf[TEST_SIZE];
+static char check[TEST_SIZE];
+
+static size_t
+return_random (void)
+{
+  return random_ulong () % 1031 + 1;
+}
+
+void
+test_main (void)
+{
+  struct iovec iov[BATCH];
+  size_t ofs;
+  int block_cnt = 0;
+  int call_cnt = 0;
+  int fd;
+
+  random_init (-1);
+  random_bytes (buf, sizeof buf);
+
+  CHECK (create ("nibble", 0), "create \"nibble\"");
+  CHECK ((fd = open ("nibble")) > 1, "open \"nibble\"");
+
+  msg ("writing \"nibble\"");
+  ofs = 0;
+  while (ofs < sizeof buf)
+    {
+      size_t batch_ofs = ofs;
+      int cnt;
+
+      for (cnt = 0; cnt < BATCH && ofs < sizeof buf; cnt++)
+        {
+          size_t block_size = return_random ();
+          if (block_size > sizeof buf - ofs)
+            block_size = sizeof buf - ofs;
+          iov[cnt].iov_base = buf + ofs;
+          iov[cnt].iov_len = block_size;
+          ofs += block_size;
+        }
+      if (writev (fd, iov, cnt) != (int) (ofs - batch_ofs))
+        fail ("writev %zu bytes at offset %zu failed",
+              ofs - batch_ofs, batch_ofs);
+      block_cnt += cnt;
+      call_cnt++;
+    }
+  if (tell (fd) != sizeof buf)
+    fail ("file position is %u after writev, expected %zu",
+          tell (fd), sizeof buf);
+
+  msg ("verifying \"nibble\" with pread");
+  if (pread (fd, check, sizeof check, 0) != sizeof check)
+    fail ("pread of \"nibble\" failed");
+  compare_bytes (check, buf, sizeof buf, 0, "nibble");
+  if (pwrite (fd, buf, 1, 0) != 1)
+    fail ("pwrite of \"nibble\" failed");
+  if (tell (fd) != sizeof buf)
+    fail ("pread or pwrite moved the file position");
+  msg ("close \"nibble\"");
+  close (fd);
+
+  msg ("write: %d calls", block_cnt);
+  msg ("writev: %d calls", call_cnt);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(lg-seq-vec\) \w+: \d+ calls$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(lg-seq-vec) begin
+(lg-seq-vec) create "nibble"
+(lg-seq-vec) open "nibble"
+(lg-seq-vec) writing "nibble"
+(lg-seq-vec) verifying "nibble" with pread
+(lg-seq-vec) close "nibble"
+(lg-seq-vec) end
+EOF
+pass;
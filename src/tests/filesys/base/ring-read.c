@@ -0,0 +1,78 @@
+/* Measures many small file reads made one system call at a time
+   against the same reads queued on a submission ring, a ring's
+   worth per ring_enter() call, and checks that both read the
+   right data. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 16384
+#define READ_SIZE 64
+#define READ_CNT (FILE_SIZE / READ_SIZE)
+#define PASS_CNT 8
+
+static char buf[FILE_SIZE];
+static char check[FILE_SIZE];
+static struct ring ring;
+
+void
+test_main (void)
+{
+  int fd;
+  int start;
+  int call_cnt;
+  int pass, i;
+
+  random_init (0);
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("ring", sizeof buf), "create \"ring\"");
+  CHECK ((fd = open ("ring")) > 1, "open \"ring\"");
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf, "write \"ring\"");
+
+  start = get_ticks ();
+  for (pass = 0; pass < PASS_CNT; pass++)
+    {
+      seek (fd, 0);
+      for (i = 0; i < READ_CNT; i++)
+        if (read (fd, check + i * READ_SIZE, READ_SIZE) != READ_SIZE)
+          fail ("read %d failed", i);
+    }
+  msg ("read: %d calls in %d ticks", PASS_CNT * READ_CNT,
+       get_ticks () - start);
+  compare_bytes (check, buf, sizeof buf, 0, "ring");
+
+  memset (check, 0, sizeof check);
+  call_cnt = 0;
+  start = get_ticks ();
+  for (pass = 0; pass < PASS_CNT; pass++)
+    for (i = 0; i < READ_CNT; )
+      {
+        /* Fill the submission queue, then run it all at once. */
+        while (i < READ_CNT && ring.sq_tail - ring.sq_head < RING_ENTRIES)
+          {
+            struct ring_sqe *sqe = &ring.sq[ring.sq_tail++ % RING_ENTRIES];
+            sqe->op = RING_OP_READ;
+            sqe->fd = fd;
+            sqe->buf = check + i * READ_SIZE;
+            sqe->len = READ_SIZE;
+            sqe->offset = i * READ_SIZE;
+            sqe->user_data = i++;
+          }
+        ring_enter (&ring, ring.sq_tail - ring.sq_head);
+        call_cnt++;
+        while (ring.cq_head != ring.cq_tail)
+          {
+            struct ring_cqe *cqe = &ring.cq[ring.cq_head++ % RING_ENTRIES];
+            if (cqe->result != READ_SIZE)
+              fail ("ring read %u failed", cqe->user_data);
+          }
+      }
+  msg ("ring: %d calls in %d ticks", call_cnt, get_ticks () - start);
+  compare_bytes (check, buf, sizeof buf, 0, "ring");
+
+  msg ("close \"ring\"");
+  close (fd);
+}
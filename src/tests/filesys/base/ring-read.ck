@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(ring-read\) \w+: \d+ calls in \d+ ticks$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(ring-read) begin
+(ring-read) create "ring"
+(ring-read) open "ring"
+(ring-read) write "ring"
+(ring-read) close "ring"
+(ring-read) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Seeks far past the end of an empty file, into the range
+   reached through the doubly indirect block, and writes one
+   byte, then reports how many sectors the buffer cache had to
+   write back and the ticks taken, and checks that the hole in
+   front of the byte reads as zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (1024 * 1024)
+#define BLOCK_SIZE 512
+
+static char block[BLOCK_SIZE];
+static char zeros[BLOCK_SIZE];
+
+void
+test_main (void)
+{
+  char byte = 'x';
+  int fd, ofs, start, flushed;
+
+  CHECK (create ("sparse", 0), "create \"sparse\"");
+  CHECK ((fd = open ("sparse")) > 1, "open \"sparse\"");
+  cache_flush ();
+
+  start = get_ticks ();
+  CHECK (pwrite (fd, &byte, 1, FILE_SIZE - 1) == 1,
+         "write 1 byte at %d", FILE_SIZE - 1);
+  flushed = cache_flush ();
+  msg ("write: %d ticks", get_ticks () - start);
+  msg ("flush: %d sectors", flushed);
+  CHECK (filesize (fd) == FILE_SIZE, "filesize is %d", FILE_SIZE);
+
+  for (ofs = 0; ofs < FILE_SIZE - BLOCK_SIZE; ofs += BLOCK_SIZE)
+    if (pread (fd, block, BLOCK_SIZE, ofs) != BLOCK_SIZE
+        || memcmp (block, zeros, BLOCK_SIZE))
+      fail ("hole at %d does not read as zeros", ofs);
+  msg ("hole reads as zeros");
+  CHECK (pread (fd, block, BLOCK_SIZE, ofs) == BLOCK_SIZE
+         && !memcmp (block, zeros, BLOCK_SIZE - 1)
+         && block[BLOCK_SIZE - 1] == byte, "last sector has the byte");
+
+  msg ("close \"sparse\"");
+  close (fd);
+}
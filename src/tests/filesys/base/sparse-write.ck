@@ -0,0 +1,29 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+
+# The flush writes the byte's sector, the sector the empty file's
+# inline data moved to, and the free map, plus at most the three
+# index blocks leading to the byte; zero-filling the hole would
+# write over 2000.
+my ($flushed) = map (/^\(sparse-write\) flush: (\d+) sectors$/, @output);
+fail "No flush count found in output.\n" if !defined $flushed;
+fail "Flush wrote $flushed sectors, more than 6: the hole was filled in.\n"
+  if $flushed > 6;
+@output = grep (!/^\(sparse-write\) \w+: \d+ (ticks|sectors)$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(sparse-write) begin
+(sparse-write) create "sparse"
+(sparse-write) open "sparse"
+(sparse-write) write 1 byte at 1048575
+(sparse-write) filesize is 1048576
+(sparse-write) hole reads as zeros
+(sparse-write) last sector has the byte
+(sparse-write) close "sparse"
+(sparse-write) end
+EOF
+pass;
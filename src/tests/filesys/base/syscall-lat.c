@@ -0,0 +1,50 @@
+/* Measures system call latency.  Times a large number of cheap
+   system calls, then reads and writes whose buffer spans a page
+   boundary, so that validating user memory is a large share of
+   the work done per call. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define CALL_CNT 20000
+#define RW_CNT 500
+
+static char buf[4096 + 512];
+
+void
+test_main (void)
+{
+  int fd;
+  int start;
+  int i;
+
+  CHECK (create ("lat", sizeof buf), "create \"lat\"");
+  CHECK ((fd = open ("lat")) > 1, "open \"lat\"");
+
+  start = get_ticks ();
+  for (i = 0; i < CALL_CNT; i++)
+    tell (fd);
+  msg ("tell: %d calls in %d ticks", CALL_CNT, get_ticks () - start);
+
+  start = get_ticks ();
+  for (i = 0; i < RW_CNT; i++)
+    {
+      seek (fd, 0);
+      if (write (fd, buf, sizeof buf) != sizeof buf)
+        fail ("write %d failed", i);
+    }
+  msg ("write: %d calls in %d ticks", RW_CNT, get_ticks () - start);
+
+  start = get_ticks ();
+  for (i = 0; i < RW_CNT; i++)
+    {
+      seek (fd, 0);
+      if (read (fd, buf, sizeof buf) != sizeof buf)
+        fail ("read %d failed", i);
+    }
+  msg ("read: %d calls in %d ticks", RW_CNT, get_ticks () - start);
+
+  msg ("close \"lat\"");
+  close (fd);
+}
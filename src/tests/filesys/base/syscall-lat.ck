@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(syscall-lat\) \w+: \d+ calls in \d+ ticks$/, @output);
+compare_output ("run", IGNORE_EXIT_CODES => 1, \@output, [<<'EOF']);
+(syscall-lat) begin
+(syscall-lat) create "lat"
+(syscall-lat) open "lat"
+(syscall-lat) close "lat"
+(syscall-lat) end
+EOF
+pass;
@@ -0,0 +1,87 @@
+/* Lists a directory of many files with getdents(), after first
+   reading one entry with readdir(), and checks that every entry
+   is returned exactly once with the right type and inumber. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+#define BATCH 8
+
+void
+test_main (void) 
+{
+  struct dirent entries[BATCH];
+  bool seen[FILE_CNT + 1];
+  char name[READDIR_MAX_LEN + 1];
+  char path[READDIR_MAX_LEN + 3];
+  int dir_fd, fd, cnt, total, i;
+
+  CHECK (mkdir ("d"), "mkdir \"d\"");
+  CHECK (mkdir ("d/sub"), "mkdir \"d/sub\"");
+  msg ("creating d/f0 through d/f%d...", FILE_CNT - 1);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "d/f%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\" failed", name);
+    }
+
+  CHECK ((dir_fd = open ("d")) > 1, "open \"d\"");
+  memset (seen, 0, sizeof seen);
+  CHECK (readdir (dir_fd, name), "readdir \"d\"");
+  total = 1;
+  if (!strcmp (name, "sub"))
+    seen[FILE_CNT] = true;
+  else
+    seen[atoi (name + 1)] = true;
+
+  msg ("getdents \"d\" in batches of %d", BATCH);
+  while ((cnt = getdents (dir_fd, entries, BATCH)) > 0)
+    for (i = 0; i < cnt; i++)
+      {
+        struct dirent *e = &entries[i];
+        int idx;
+
+        if (!strcmp (e->name, "sub"))
+          {
+            if (!e->is_dir)
+              fail ("\"sub\" is not a directory");
+            idx = FILE_CNT;
+          }
+        else
+          {
+            if (e->name[0] != 'f' || e->is_dir)
+              fail ("unexpected entry \"%s\"", e->name);
+            idx = atoi (e->name + 1);
+            if (idx < 0 || idx >= FILE_CNT)
+              fail ("unexpected entry \"%s\"", e->name);
+          }
+        if (seen[idx])
+          fail ("\"%s\" listed twice", e->name);
+        seen[idx] = true;
+        total++;
+
+        snprintf (path, sizeof path, "d/%s", e->name);
+        fd = open (path);
+        if (fd < 2 || inumber (fd) != e->inumber)
+          fail ("wrong inumber for \"%s\"", e->name);
+        close (fd);
+      }
+  if (cnt < 0)
+    fail ("getdents failed");
+  if (total != FILE_CNT + 1)
+    fail ("listed %d entries, expected %d", total, FILE_CNT + 1);
+  CHECK (getdents (dir_fd, entries, BATCH) == 0,
+         "getdents \"d\" at end (must return 0)");
+  close (dir_fd);
+
+  CHECK ((fd = open ("d/f0")) > 1, "open \"d/f0\"");
+  CHECK (getdents (fd, entries, BATCH) == -1,
+         "getdents \"d/f0\" (must return -1)");
+  close (fd);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dir-getdents) begin
+(dir-getdents) mkdir "d"
+(dir-getdents) mkdir "d/sub"
+(dir-getdents) creating d/f0 through d/f39...
+(dir-getdents) open "d"
+(dir-getdents) readdir "d"
+(dir-getdents) getdents "d" in batches of 8
+(dir-getdents) getdents "d" at end (must return 0)
+(dir-getdents) open "d/f0"
+(dir-getdents) getdents "d/f0" (must return -1)
+(dir-getdents) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Puts 1000 threads to sleep at once, for durations spread over
+   1 to 300 ticks so that some of them wrap around the timer
+   wheel, and has each sleep several times.  Reports how late the
+   sleepers woke up and how long the whole run took. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define SLEEPER_CNT 1000
+#define SLEEP_CNT 3
+#define MAX_DURATION 300
+
+static thread_func sleeper;
+
+static struct semaphore sleepers_done;
+static int64_t total_late, max_late;
+
+void
+test_alarm_many (void) 
+{
+  int64_t start;
+  int i;
+
+  sema_init (&sleepers_done, 0);
+  total_late = max_late = 0;
+
+  msg ("Starting %d threads sleeping %d times each.",
+       SLEEPER_CNT, SLEEP_CNT);
+  start = timer_ticks ();
+  for (i = 0; i < SLEEPER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "sleeper %d", i);
+      if (thread_create (name, PRI_DEFAULT, sleeper, (void *) i) == TID_ERROR)
+        fail ("thread_create() returned TID_ERROR");
+    }
+  for (i = 0; i < SLEEPER_CNT; i++)
+    sema_down (&sleepers_done);
+
+  msg ("%d wakeups in %lld ticks, %lld ticks late in total, %lld max",
+       SLEEPER_CNT * SLEEP_CNT, timer_elapsed (start), total_late, max_late);
+}
+
+static void
+sleeper (void *id_) 
+{
+  int id = (int) id_;
+  int i;
+
+  for (i = 0; i < SLEEP_CNT; i++) 
+    {
+      int64_t duration = (id * 37 + i * 101) % MAX_DURATION + 1;
+      int64_t wake = timer_ticks () + duration;
+      int64_t late;
+      enum intr_level old_level;
+
+      timer_sleep (duration);
+      late = timer_ticks () - wake;
+
+      old_level = intr_disable ();
+      total_late += late;
+      if (late > max_late)
+        max_late = late;
+      intr_set_level (old_level);
+    }
+  sema_up (&sleepers_done);
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(alarm-many\) \d+ wakeups in \d+ ticks, \d+ ticks late in total, \d+ max$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(alarm-many) begin
+(alarm-many) Starting 1000 threads sleeping 3 times each.
+(alarm-many) end
+EOF
+pass;
@@ -0,0 +1,160 @@
+/* Runs the same mixed workload of single-page and multi-page
+   allocations and frees against the page allocator and against
+   a first-fit bitmap allocator like the one it replaced, which
+   is simulated over a bitmap of the same size.  Reports, for
+   each, how many multi-page requests failed even though enough
+   pages were free, and how long the workload took.  In debug
+   builds palloc also poisons freed pages, which the simulation
+   does not, so its time is an upper bound. */
+
+#include <bitmap.h>
+#include <random.h>
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "devices/timer.h"
+
+#define STEP_CNT 20000          /* Allocations and frees to perform. */
+#define MAX_SLOT_CNT 1024       /* Most allocations live at once. */
+#define MAX_REQUEST 16          /* Largest request, in pages. */
+#define SLACK_PAGES 32          /* Kernel pages left for others. */
+
+/* A live allocation. */
+struct slot
+  {
+    size_t page_cnt;            /* Size in pages, 0 if unused. */
+    void *pages;                /* Pages from palloc. */
+    size_t page_idx;            /* First page in the bitmap. */
+  };
+
+/* One run of the workload. */
+struct result
+  {
+    int requests;               /* Allocation requests. */
+    int failures;               /* ...that failed. */
+    int fragmented;             /* ...although enough pages were free. */
+    int64_t ticks;              /* Time taken. */
+  };
+
+static struct slot slots[MAX_SLOT_CNT];
+
+static void run_workload (bool buddy, size_t page_cnt, size_t slot_cnt,
+                          struct result *);
+static size_t request_size (void);
+
+void
+test_palloc_frag (void) 
+{
+  struct result bitmap, buddy;
+  size_t page_cnt, slot_cnt;
+
+  page_cnt = palloc_free_cnt (0);
+  if (page_cnt <= SLACK_PAGES + MAX_REQUEST)
+    fail ("only %zu free kernel pages", page_cnt);
+  page_cnt -= SLACK_PAGES;
+
+  /* About half the slots are live at a time and requests average
+     three pages, so this keeps the pool about 3/4 full. */
+  slot_cnt = page_cnt / 2;
+  if (slot_cnt > MAX_SLOT_CNT)
+    slot_cnt = MAX_SLOT_CNT;
+
+  msg ("Running %d steps against the bitmap allocator.", STEP_CNT);
+  run_workload (false, page_cnt, slot_cnt, &bitmap);
+  msg ("Running %d steps against the buddy allocator.", STEP_CNT);
+  run_workload (true, page_cnt, slot_cnt, &buddy);
+
+  msg ("bitmap: %d requests, %d failed, %d fragmented, %lld ticks",
+       bitmap.requests, bitmap.failures, bitmap.fragmented, bitmap.ticks);
+  msg ("buddy: %d requests, %d failed, %d fragmented, %lld ticks",
+       buddy.requests, buddy.failures, buddy.fragmented, buddy.ticks);
+}
+
+/* Runs the workload over PAGE_CNT pages using SLOT_CNT slots,
+   against palloc if BUDDY, otherwise against a simulated
+   first-fit bitmap allocator, and stores the outcome in R. */
+static void
+run_workload (bool buddy, size_t page_cnt, size_t slot_cnt,
+              struct result *r)
+{
+  struct bitmap *map = NULL;
+  size_t free_cnt = page_cnt;
+  int64_t start;
+  size_t i;
+  int step;
+
+  if (!buddy)
+    {
+      map = bitmap_create (page_cnt);
+      if (map == NULL)
+        fail ("bitmap_create() failed");
+    }
+
+  random_init (0);
+  r->requests = r->failures = r->fragmented = 0;
+  start = timer_ticks ();
+  for (step = 0; step < STEP_CNT; step++)
+    {
+      struct slot *s = &slots[random_ulong () % slot_cnt];
+
+      if (s->page_cnt > 0)
+        {
+          /* Free the slot's allocation. */
+          if (buddy)
+            palloc_free_multiple (s->pages, s->page_cnt);
+          else
+            bitmap_set_multiple (map, s->page_idx, s->page_cnt, false);
+          free_cnt += s->page_cnt;
+          s->page_cnt = 0;
+          continue;
+        }
+
+      /* Allocate into the slot.  A request that fails although
+         enough pages are free is a sign of fragmentation. */
+      s->page_cnt = request_size ();
+      r->requests++;
+      if (free_cnt < s->page_cnt)
+        {
+          r->failures++;
+          s->page_cnt = 0;
+          continue;
+        }
+      if (buddy)
+        s->pages = palloc_get_multiple (0, s->page_cnt);
+      else
+        s->page_idx = bitmap_scan_and_flip (map, 0, s->page_cnt, false);
+      if (buddy ? s->pages == NULL : s->page_idx == BITMAP_ERROR)
+        {
+          r->failures++;
+          r->fragmented++;
+          s->page_cnt = 0;
+          continue;
+        }
+      free_cnt -= s->page_cnt;
+    }
+  r->ticks = timer_ticks () - start;
+
+  /* Free whatever is left. */
+  for (i = 0; i < slot_cnt; i++)
+    if (slots[i].page_cnt > 0)
+      {
+        if (buddy)
+          palloc_free_multiple (slots[i].pages, slots[i].page_cnt);
+        slots[i].page_cnt = 0;
+      }
+  if (map != NULL)
+    bitmap_destroy (map);
+}
+
+/* Returns the size of a request: one page three times out of
+   four, otherwise 2 to MAX_REQUEST pages. */
+static size_t
+request_size (void) 
+{
+  if (random_ulong () % 4 != 0)
+    return 1;
+  return 2 + random_ulong () % (MAX_REQUEST - 1);
+}
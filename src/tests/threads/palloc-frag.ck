@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(palloc-frag\) (bitmap|buddy): \d+ requests, \d+ failed, \d+ fragmented, \d+ ticks$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(palloc-frag) begin
+(palloc-frag) Running 20000 steps against the bitmap allocator.
+(palloc-frag) Running 20000 steps against the buddy allocator.
+(palloc-frag) end
+EOF
+pass;
@@ -0,0 +1,103 @@
+/* Measures how long a high-priority thread waits for a lock held
+   by a low-priority thread while medium-priority threads keep the
+   CPU busy.  This is the situation of a process holding the file
+   or buffer cache lock during a disk read.
+
+   Without priority donation the low-priority holder never runs
+   until the CPU-bound threads give up, so the high-priority
+   thread waits for HOG_TICKS.  With donation the wait is only as
+   long as the holder's critical section, HOLD_TICKS. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define HOG_CNT 8
+#define HOLD_TICKS 5
+#define HOG_TICKS (10 * TIMER_FREQ)
+
+static thread_func low_thread, hog_thread, high_thread;
+
+static struct lock lock;
+static volatile bool done;
+static struct semaphore hogs_done;
+static struct semaphore high_done;
+static int64_t wait_ticks;
+
+void
+test_priority_inversion (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  /* Make sure our priority is the default. */
+  ASSERT (thread_get_priority () == PRI_DEFAULT);
+
+  lock_init (&lock);
+  done = false;
+  sema_init (&hogs_done, 0);
+  sema_init (&high_done, 0);
+
+  /* Runs at once, takes the lock, and drops to a low priority. */
+  thread_create ("low", PRI_DEFAULT + 1, low_thread, NULL);
+
+  msg ("Starting %d CPU-bound threads.", HOG_CNT);
+  for (i = 0; i < HOG_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "hog %d", i);
+      thread_create (name, PRI_DEFAULT - 1, hog_thread, NULL);
+    }
+
+  thread_create ("high", PRI_MAX, high_thread, NULL);
+  sema_down (&high_done);
+
+  done = true;
+  for (i = 0; i < HOG_CNT; i++)
+    sema_down (&hogs_done);
+
+  msg ("high waited %lld ticks for the lock", wait_ticks);
+  if (wait_ticks >= HOG_TICKS)
+    fail ("priority inversion: lock holder was starved");
+}
+
+static void
+low_thread (void *aux UNUSED) 
+{
+  int64_t start;
+
+  lock_acquire (&lock);
+  thread_set_priority (PRI_MIN + 1);
+
+  /* Critical section, e.g. waiting for the disk. */
+  start = timer_ticks ();
+  while (timer_elapsed (start) < HOLD_TICKS)
+    continue;
+  lock_release (&lock);
+}
+
+static void
+hog_thread (void *aux UNUSED) 
+{
+  int64_t start = timer_ticks ();
+
+  while (!done && timer_elapsed (start) < HOG_TICKS)
+    continue;
+  sema_up (&hogs_done);
+}
+
+static void
+high_thread (void *aux UNUSED) 
+{
+  int64_t start = timer_ticks ();
+
+  lock_acquire (&lock);
+  wait_ticks = timer_elapsed (start);
+  lock_release (&lock);
+  sema_up (&high_done);
+}
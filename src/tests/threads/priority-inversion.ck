@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(priority-inversion\) high waited \d+ ticks for the lock$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(priority-inversion) begin
+(priority-inversion) Starting 8 CPU-bound threads.
+(priority-inversion) end
+EOF
+pass;
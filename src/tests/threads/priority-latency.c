@@ -0,0 +1,83 @@
+/* Measures how quickly a high-priority thread gets the CPU after
+   waking up while many CPU-bound threads are running.  The
+   high-priority thread sleeps repeatedly and, each time it wakes,
+   records how many ticks late it is.  With preemption on wakeup
+   it should run in the same tick it was woken. */
+
+#include <stdio.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/timer.h"
+
+#define HOG_CNT 16
+#define WAKE_CNT 50
+
+static thread_func hog_thread, waker_thread;
+
+static volatile bool done;
+static struct semaphore hogs_done;
+static struct semaphore waker_done;
+static int64_t total_delay, max_delay;
+
+void
+test_priority_latency (void) 
+{
+  int i;
+
+  /* This test does not work with the MLFQS. */
+  ASSERT (!thread_mlfqs);
+
+  done = false;
+  total_delay = max_delay = 0;
+  sema_init (&hogs_done, 0);
+  sema_init (&waker_done, 0);
+
+  msg ("Starting %d CPU-bound threads.", HOG_CNT);
+  for (i = 0; i < HOG_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "hog %d", i);
+      thread_create (name, PRI_DEFAULT, hog_thread, NULL);
+    }
+
+  msg ("Waking a high-priority thread %d times.", WAKE_CNT);
+  thread_create ("waker", PRI_MAX, waker_thread, NULL);
+  sema_down (&waker_done);
+
+  done = true;
+  for (i = 0; i < HOG_CNT; i++)
+    sema_down (&hogs_done);
+
+  msg ("wakeup delay: %lld ticks total, %lld ticks max",
+       total_delay, max_delay);
+}
+
+static void
+hog_thread (void *aux UNUSED) 
+{
+  while (!done)
+    continue;
+  sema_up (&hogs_done);
+}
+
+static void
+waker_thread (void *aux UNUSED) 
+{
+  int i;
+
+  for (i = 0; i < WAKE_CNT; i++) 
+    {
+      int64_t sleep = i % 3 + 1;
+      int64_t wake = timer_ticks () + sleep;
+      int64_t delay;
+
+      timer_sleep (sleep);
+      delay = timer_ticks () - wake;
+      total_delay += delay;
+      if (delay > max_delay)
+        max_delay = delay;
+    }
+  sema_up (&waker_done);
+}
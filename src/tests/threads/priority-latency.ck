@@ -0,0 +1,15 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^\(priority-latency\) wakeup delay: \d+ ticks total, \d+ ticks max$/, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(priority-latency) begin
+(priority-latency) Starting 16 CPU-bound threads.
+(priority-latency) Waking a high-priority thread 50 times.
+(priority-latency) end
+EOF
+pass;
@@ -0,0 +1,72 @@
+/* Allocates many objects from a slab cache whose objects do not
+   fit malloc()'s size classes well, checks that each was
+   constructed and that none overlap, frees them, and then
+   checks that reallocated objects are still constructed. */
+
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "threads/init.h"
+#include "threads/slab.h"
+
+#define OBJ_CNT 64
+#define OBJ_MAGIC 0x0b1ec7ed
+
+struct object
+  {
+    unsigned magic;             /* Set by the constructor. */
+    int idx;                    /* Index in objs[]. */
+    char data[522];             /* Pads the object to 530 bytes. */
+  };
+
+static void object_ctor (void *);
+
+void
+test_slab_alloc (void) 
+{
+  static struct object *objs[OBJ_CNT];
+  struct kmem_cache *cache;
+  int pass, i;
+
+  cache = kmem_cache_create ("test", sizeof (struct object), object_ctor);
+  if (cache == NULL)
+    fail ("kmem_cache_create() returned null");
+
+  for (pass = 0; pass < 2; pass++)
+    {
+      msg ("Allocating %d objects.", OBJ_CNT);
+      for (i = 0; i < OBJ_CNT; i++) 
+        {
+          objs[i] = kmem_cache_alloc (cache);
+          if (objs[i] == NULL)
+            fail ("kmem_cache_alloc() returned null");
+          if (objs[i]->magic != OBJ_MAGIC)
+            fail ("object %d was not constructed", i);
+          objs[i]->idx = i;
+          memset (objs[i]->data, i, sizeof objs[i]->data);
+        }
+
+      for (i = 0; i < OBJ_CNT; i++) 
+        {
+          size_t j;
+
+          if (objs[i]->idx != i)
+            fail ("object %d was overwritten", i);
+          for (j = 0; j < sizeof objs[i]->data; j++)
+            if (objs[i]->data[j] != (char) i)
+              fail ("object %d data was overwritten", i);
+        }
+
+      msg ("Freeing %d objects.", OBJ_CNT);
+      for (i = 0; i < OBJ_CNT; i++) 
+        kmem_cache_free (cache, objs[i]);
+    }
+}
+
+/* Constructs object OBJ. */
+static void
+object_ctor (void *obj_) 
+{
+  struct object *obj = obj_;
+  obj->magic = OBJ_MAGIC;
+}
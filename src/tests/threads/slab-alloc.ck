@@ -0,0 +1,13 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(slab-alloc) begin
+(slab-alloc) Allocating 64 objects.
+(slab-alloc) Freeing 64 objects.
+(slab-alloc) Allocating 64 objects.
+(slab-alloc) Freeing 64 objects.
+(slab-alloc) end
+EOF
+pass;
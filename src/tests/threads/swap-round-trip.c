@@ -0,0 +1,128 @@
+/* Round-trips pages through swap_out() and swap_in(): a page of
+   zeros, one that compresses into the RAM pool, one that does
+   not and goes to the swap device, and then enough compressible
+   pages to overflow the pool, so that its oldest pages are
+   spilled to the device.  The swap device is a RAM disk that
+   the test registers itself. */
+
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "tests/threads/tests.h"
+#include "devices/block.h"
+#include "threads/init.h"
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+#define DISK_PAGES 64           /* Size of the RAM swap device. */
+#define SPILL_PAGES 320         /* Pages that overflow the pool. */
+#define RANDOM_BYTES 900        /* Random prefix of a compressible page. */
+
+static uint8_t *disk;           /* RAM swap device contents. */
+static int disk_writes;         /* Sectors written to it. */
+
+static void disk_read (void *, block_sector_t, void *);
+static void disk_write (void *, block_sector_t, const void *);
+
+static const struct block_operations disk_ops = { disk_read, disk_write };
+
+/* Fills KPAGE with RANDOM_CNT random bytes drawn from SEED,
+   followed by zeros. */
+static void
+fill_page (uint8_t *kpage, unsigned seed, size_t random_cnt)
+{
+  random_init (seed);
+  random_bytes (kpage, random_cnt);
+  memset (kpage + random_cnt, 0, PGSIZE - random_cnt);
+}
+
+/* Swaps out the page at KPAGE and back in to BUF, and checks
+   that it came back unchanged. */
+static void
+round_trip (const char *what, const uint8_t *kpage, uint8_t *buf)
+{
+  struct swap_slot *s = swap_out (kpage);
+
+  if (s == NULL)
+    fail ("swap_out() of %s page returned null", what);
+  memset (buf, 0xcc, PGSIZE);
+  swap_in (s, buf);
+  if (memcmp (kpage, buf, PGSIZE))
+    fail ("%s page came back changed", what);
+}
+
+void
+test_swap_round_trip (void) 
+{
+  static struct swap_slot *slots[SPILL_PAGES];
+  uint8_t *page, *buf;
+  int i;
+
+  disk = palloc_get_multiple (0, DISK_PAGES);
+  page = palloc_get_page (0);
+  buf = palloc_get_page (0);
+  if (disk == NULL || page == NULL || buf == NULL)
+    fail ("out of memory");
+  block_set_role (BLOCK_SWAP,
+                  block_register ("swap-test", BLOCK_SWAP, NULL,
+                                  DISK_PAGES * (PGSIZE / BLOCK_SECTOR_SIZE),
+                                  &disk_ops, NULL));
+  swap_compress = true;
+  swap_init ();
+
+  msg ("Swapping a zero page.");
+  fill_page (page, 0, 0);
+  round_trip ("zero", page, buf);
+
+  msg ("Swapping a compressible page.");
+  fill_page (page, 1, RANDOM_BYTES);
+  round_trip ("compressible", page, buf);
+  if (disk_writes != 0)
+    fail ("compressible page was written to the swap device");
+
+  msg ("Swapping an incompressible page.");
+  fill_page (page, 2, PGSIZE);
+  round_trip ("incompressible", page, buf);
+  if (disk_writes == 0)
+    fail ("incompressible page was not written to the swap device");
+
+  msg ("Swapping out %d compressible pages.", SPILL_PAGES);
+  disk_writes = 0;
+  for (i = 0; i < SPILL_PAGES; i++) 
+    {
+      fill_page (page, 100 + i, RANDOM_BYTES);
+      slots[i] = swap_out (page);
+      if (slots[i] == NULL)
+        fail ("swap_out() of page %d returned null", i);
+    }
+  if (disk_writes == 0)
+    fail ("no page was spilled from the pool");
+
+  msg ("Swapping them back in.");
+  for (i = 0; i < SPILL_PAGES; i++) 
+    {
+      swap_in (slots[i], buf);
+      fill_page (page, 100 + i, RANDOM_BYTES);
+      if (memcmp (page, buf, PGSIZE))
+        fail ("page %d came back changed", i);
+    }
+
+  palloc_free_page (buf);
+  palloc_free_page (page);
+}
+
+/* Reads SECTOR of the RAM swap device into BUFFER. */
+static void
+disk_read (void *aux UNUSED, block_sector_t sector, void *buffer) 
+{
+  memcpy (buffer, disk + sector * BLOCK_SECTOR_SIZE, BLOCK_SECTOR_SIZE);
+}
+
+/* Writes BUFFER to SECTOR of the RAM swap device. */
+static void
+disk_write (void *aux UNUSED, block_sector_t sector, const void *buffer) 
+{
+  memcpy (disk + sector * BLOCK_SECTOR_SIZE, buffer, BLOCK_SECTOR_SIZE);
+  disk_writes++;
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+our ($test);
+my (@output) = read_text_file ("$test.output");
+common_checks ("run", @output);
+@output = grep (!/^swap-test: \d+ sectors /, @output);
+compare_output ("run", \@output, [<<'EOF']);
+(swap-round-trip) begin
+(swap-round-trip) Swapping a zero page.
+(swap-round-trip) Swapping a compressible page.
+(swap-round-trip) Swapping an incompressible page.
+(swap-round-trip) Swapping out 320 compressible pages.
+(swap-round-trip) Swapping them back in.
+(swap-round-trip) end
+EOF
+pass;
@@ -2,46 +2,130 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
-#include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* Page allocator.  Hands out memory in page-size (or
    page-multiple) chunks.  See malloc.h for an allocator that
    hands out smaller chunks.
 
-   System memory is divided into two "pools" called the kernel
-   and user pools.  The user pool is for user (virtual) memory
-   pages, the kernel pool for everything else.  The idea here is
-   that the kernel needs to have memory for its own operations
-   even if user processes are swapping like mad.
+   All of system memory is managed as one pool, from which both
+   the kernel and user processes take pages.  Pages requested
+   with PAL_USER are for user (virtual) memory, the rest for
+   everything else.  Rather than splitting memory in fixed halves,
+   which starves the kernel of pages while user memory sits idle
+   or vice versa, each side may grow into whatever the other does
+   not use, within two limits: user pages never exceed the
+   "-ul" limit, and user requests never take the last
+   KERNEL_RESERVE_DIV-th of memory, so that the kernel has memory
+   for its own operations even if user processes are swapping
+   like mad.
 
-   By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   Caches that only hold memory to go faster, like the buffer
+   cache, register a "shrinker" with palloc_register_shrinker().
+   When a request cannot be met, the shrinkers are asked to give
+   pages back and the request is retried.  Conversely, such
+   caches may grow while palloc_memory_idle() says that plenty of
+   memory is free.
+
+   The pool is a binary buddy allocator.  Free memory is kept as
+   blocks of 2**ORDER pages, each aligned to its size relative to
+   the pool base, on one free list per order.  A request for N
+   pages takes the smallest block that fits, splitting larger
+   blocks as needed, and gives back the block's tail beyond N
+   pages.  Freeing a block merges it with its "buddy", the other
+   half of the next larger block, for as long as the buddy is
+   free too.  Both take O(log n) time, so the pool is guarded
+   by disabling interrupts rather than by a lock, which lets
+   pages be freed from the scheduler too.
+
+   The idle thread zeroes free pages ahead of time through
+   palloc_zero_free_page(), so that PAL_ZERO requests can usually
+   be served without a memset() on the critical path.  The pool
+   tracks which of its free pages are known to be zero. */
+
+/* Number of block orders.  The largest block is
+   2**(PALLOC_ORDERS - 1) pages. */
+#define PALLOC_ORDERS 11
+
+/* Number of order-0 free blocks that a single-page PAL_ZERO
+   request examines looking for a page that is already zero. */
+#define ZERO_SCAN_MAX 8
+
+/* Number of pages that palloc_zero_free_page() examines with
+   interrupts off at a time. */
+#define ZERO_SCAN_CHUNK 64
+
+/* User pages may not take the last 1/KERNEL_RESERVE_DIV of
+   memory. */
+#define KERNEL_RESERVE_DIV 8
+
+/* palloc_memory_idle() is true while more than
+   1/IDLE_MEMORY_DIV of memory is free. */
+#define IDLE_MEMORY_DIV 4
+
+/* Maximum number of registered shrinkers. */
+#define SHRINKER_CNT 4
+
+/* Per-page information.  Only meaningful for the first page of
+   a free block. */
+struct page_info
+  {
+    struct list_elem free_elem;         /* Element in a free list. */
+    int order;                          /* Order if free block, else -1. */
+  };
 
 /* A memory pool. */
 struct pool
   {
-    struct lock lock;                   /* Mutual exclusion. */
+    struct list free_lists[PALLOC_ORDERS]; /* Free blocks, by order. */
+    struct page_info *info;             /* Information for each page. */
     struct bitmap *used_map;            /* Bitmap of free pages. */
+    struct bitmap *zero_map;            /* Free pages known to be zero. */
+    struct bitmap *user_map;            /* Pages allocated with PAL_USER. */
+    size_t free_cnt;                    /* Number of free pages. */
+    size_t user_cnt;                    /* Number of user pages. */
+    size_t user_limit;                  /* Maximum number of user pages. */
+    size_t reserve;                     /* Free pages kept from users. */
+    size_t zero_cursor;                 /* Where the idle zeroing resumes. */
     uint8_t *base;                      /* Base of pool. */
   };
 
-/* Two pools: one for kernel data, one for user pages. */
-static struct pool kernel_pool, user_pool;
+/* Statistics. */
+static long long zero_requests;  /* Pages requested with PAL_ZERO. */
+static long long zero_hits;      /* ...that were already zero. */
+static long long idle_zeroed;    /* Pages zeroed by the idle thread. */
+static long long shrink_calls;   /* Times the shrinkers were run. */
+static long long shrunk_pages;   /* Pages they reported freeing. */
+
+/* The pool of all pages. */
+static struct pool page_pool;
+
+/* Registered shrinkers. */
+static palloc_shrink_func *shrinkers[SHRINKER_CNT];
+static int shrinker_cnt;
 
 static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
+                       size_t user_page_limit);
 static bool page_from_pool (const struct pool *, void *page);
+static bool may_allocate (const struct pool *, enum palloc_flags,
+                          size_t page_cnt);
+static size_t alloc_pages (struct pool *, size_t page_cnt, bool zero);
+static void release_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static void free_block (struct pool *, size_t page_idx, int order);
+static bool run_shrinkers (size_t page_cnt);
+static bool zero_one_page (struct pool *);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
-   pages are put into the user pool. */
+   pages are used for user pages. */
 void
 palloc_init (size_t user_page_limit)
 {
@@ -49,64 +133,73 @@ palloc_init (size_t user_page_limit)
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  init_pool (&page_pool, free_start, free_pages, user_page_limit);
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
-   If PAL_USER is set, the pages are obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the pages are filled with zeros.  If too few pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   If PAL_USER is set, the pages count as user pages, otherwise
+   as kernel pages.  If PAL_ZERO is set in FLAGS, then the pages
+   are filled with zeros.  If too few pages are available even
+   after running the shrinkers, returns a null pointer, unless
+   PAL_ASSERT is set in FLAGS, in which case the kernel panics. */
 void *
 palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
 {
-  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
-  void *pages;
-  size_t page_idx;
+  struct pool *pool = &page_pool;
+  void *pages = NULL;
+  size_t page_idx = BITMAP_ERROR;
+  bool need_zero = false;
+  enum intr_level old_level;
 
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
-
-  if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
-  else
-    pages = NULL;
-
-  if (pages != NULL) 
+  for (;;)
     {
-      if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
-    }
-  else 
-    {
-      if (flags & PAL_ASSERT)
-        PANIC ("palloc_get: out of pages");
+      old_level = intr_disable ();
+      if (may_allocate (pool, flags, page_cnt))
+        page_idx = alloc_pages (pool, page_cnt, flags & PAL_ZERO);
+      if (page_idx != BITMAP_ERROR)
+        {
+          pages = pool->base + PGSIZE * page_idx;
+          if (flags & PAL_USER)
+            {
+              bitmap_set_multiple (pool->user_map, page_idx, page_cnt, true);
+              pool->user_cnt += page_cnt;
+            }
+          if (flags & PAL_ZERO)
+            {
+              size_t zeroed = bitmap_count (pool->zero_map, page_idx,
+                                            page_cnt, true);
+              zero_requests += page_cnt;
+              zero_hits += zeroed;
+              need_zero = zeroed < page_cnt;
+            }
+          bitmap_set_multiple (pool->zero_map, page_idx, page_cnt, false);
+        }
+      intr_set_level (old_level);
+
+      /* Give up, unless the shrinkers can make room. */
+      if (pages != NULL || !run_shrinkers (page_cnt))
+        break;
     }
 
+  if (need_zero)
+    memset (pages, 0, PGSIZE * page_cnt);
+  if (pages == NULL && (flags & PAL_ASSERT))
+    PANIC ("palloc_get: out of pages");
+
   return pages;
 }
 
 /* Obtains a single free page and returns its kernel virtual
    address.
-   If PAL_USER is set, the page is obtained from the user pool,
-   otherwise from the kernel pool.  If PAL_ZERO is set in FLAGS,
-   then the page is filled with zeros.  If no pages are
-   available, returns a null pointer, unless PAL_ASSERT is set in
-   FLAGS, in which case the kernel panics. */
+   If PAL_USER is set, the page counts as a user page, otherwise
+   as a kernel page.  If PAL_ZERO is set in FLAGS, then the page
+   is filled with zeros.  If no pages are available, returns a
+   null pointer, unless PAL_ASSERT is set in FLAGS, in which case
+   the kernel panics. */
 void *
 palloc_get_page (enum palloc_flags flags) 
 {
@@ -117,28 +210,21 @@ palloc_get_page (enum palloc_flags flags)
 void
 palloc_free_multiple (void *pages, size_t page_cnt) 
 {
-  struct pool *pool;
-  size_t page_idx;
+  struct pool *pool = &page_pool;
+  enum intr_level old_level;
 
   ASSERT (pg_ofs (pages) == 0);
   if (pages == NULL || page_cnt == 0)
     return;
-
-  if (page_from_pool (&kernel_pool, pages))
-    pool = &kernel_pool;
-  else if (page_from_pool (&user_pool, pages))
-    pool = &user_pool;
-  else
-    NOT_REACHED ();
-
-  page_idx = pg_no (pages) - pg_no (pool->base);
+  ASSERT (page_from_pool (pool, pages));
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  old_level = intr_disable ();
+  release_pages (pool, pg_no (pages) - pg_no (pool->base), page_cnt);
+  intr_set_level (old_level);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +234,359 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Frees the PAGE_CNT single pages whose addresses are in the
+   array PAGES, which need not be contiguous.  Interrupts are
+   disabled once for the whole batch rather than once per page,
+   which makes tearing down a process's address space
+   considerably cheaper.  Null entries are ignored.  The contents
+   of PAGES are clobbered. */
+void
+palloc_free_batch (void **pages, size_t page_cnt)
+{
+  struct pool *pool = &page_pool;
+  enum intr_level old_level;
+  size_t i;
+
+#ifndef NDEBUG
+  for (i = 0; i < page_cnt; i++)
+    if (pages[i] != NULL)
+      {
+        ASSERT (pg_ofs (pages[i]) == 0);
+        ASSERT (page_from_pool (pool, pages[i]));
+        memset (pages[i], 0xcc, PGSIZE);
+      }
+#endif
+
+  old_level = intr_disable ();
+  for (i = 0; i < page_cnt; i++)
+    if (pages[i] != NULL)
+      {
+        release_pages (pool, pg_no (pages[i]) - pg_no (pool->base), 1);
+        pages[i] = NULL;
+      }
+  intr_set_level (old_level);
+}
+
+/* Returns the number of pages that a request with the given
+   FLAGS could obtain without running the shrinkers.  For
+   PAL_USER this accounts for the user page limit and the kernel
+   reserve. */
+size_t
+palloc_free_cnt (enum palloc_flags flags)
+{
+  const struct pool *pool = &page_pool;
+  size_t cnt = pool->free_cnt;
+
+  if (flags & PAL_USER)
+    {
+      cnt = cnt > pool->reserve ? cnt - pool->reserve : 0;
+      if (cnt > pool->user_limit - pool->user_cnt)
+        cnt = pool->user_limit - pool->user_cnt;
+    }
+  return cnt;
+}
+
+/* Returns true if so much memory is free that caches may grow
+   beyond their usual size. */
+bool
+palloc_memory_idle (void)
+{
+  const struct pool *pool = &page_pool;
+  return pool->free_cnt > bitmap_size (pool->used_map) / IDLE_MEMORY_DIV;
+}
+
+/* Registers SHRINK to be called when a request for pages cannot
+   be met.  It is passed the number of pages wanted, should free
+   what it can without waiting on locks that the caller of
+   palloc_get_multiple() might hold, and returns the number of
+   pages it freed. */
+void
+palloc_register_shrinker (palloc_shrink_func *shrink)
+{
+  ASSERT (shrinker_cnt < SHRINKER_CNT);
+  shrinkers[shrinker_cnt++] = shrink;
+}
+
+/* Zeroes one free page that is not yet known to be zero, so that
+   a later PAL_ZERO request can skip the memset().  Meant to be
+   called by the idle thread.  Returns true if a page was zeroed,
+   false if there was nothing to do. */
+bool
+palloc_zero_free_page (void)
+{
+  return zero_one_page (&page_pool);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void)
+{
+  printf ("Palloc: %lld zeroed pages requested, %lld pre-zeroed (%lld%%), "
+          "%lld zeroed while idle\n",
+          zero_requests, zero_hits,
+          zero_requests > 0 ? zero_hits * 100 / zero_requests : 0,
+          idle_zeroed);
+  printf ("Palloc: %zu pages free, %zu user pages, "
+          "shrinkers run %lld times, %lld pages reclaimed\n",
+          page_pool.free_cnt, page_pool.user_cnt, shrink_calls,
+          shrunk_pages);
+}
+
+/* Initializes pool P as starting at BASE and spanning PAGE_CNT
+   pages, of which at most USER_PAGE_LIMIT may be user pages. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
-{
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
-
-  printf ("%zu pages available in %s.\n", page_cnt, name);
-
-  /* Initialize the pool. */
-  lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+init_pool (struct pool *p, void *base, size_t page_cnt,
+           size_t user_page_limit) 
+{
+  /* We'll put the pool's page information and bitmaps at its
+     base.  Calculate the space needed for them and subtract it
+     from the pool's size. */
+  size_t info_size = page_cnt * sizeof *p->info;
+  size_t bm_size = bitmap_buf_size (page_cnt);
+  size_t meta_pages = DIV_ROUND_UP (info_size + 3 * bm_size, PGSIZE);
+  uint8_t *bm_base = (uint8_t *) base + info_size;
+  enum intr_level old_level;
+  size_t i;
+  int order;
+  if (meta_pages > page_cnt)
+    PANIC ("Not enough memory in pool for bitmap.");
+  page_cnt -= meta_pages;
+
+  /* Initialize the pool.  Nothing is known to be zero yet. */
+  for (order = 0; order < PALLOC_ORDERS; order++)
+    list_init (&p->free_lists[order]);
+  p->info = base;
+  p->used_map = bitmap_create_in_buf (page_cnt, bm_base, bm_size);
+  p->zero_map = bitmap_create_in_buf (page_cnt, bm_base + bm_size, bm_size);
+  p->user_map = bitmap_create_in_buf (page_cnt, bm_base + 2 * bm_size,
+                                      bm_size);
+  p->free_cnt = 0;
+  p->user_cnt = 0;
+  p->reserve = page_cnt / KERNEL_RESERVE_DIV;
+  p->user_limit = page_cnt - p->reserve;
+  if (p->user_limit > user_page_limit)
+    p->user_limit = user_page_limit;
+  p->zero_cursor = 0;
+  p->base = base + meta_pages * PGSIZE;
+
+  printf ("%zu pages available, up to %zu for user pages.\n",
+          page_cnt, p->user_limit);
+
+  /* Mark every page in use, then free them all. */
+  for (i = 0; i < page_cnt; i++)
+    p->info[i].order = -1;
+  bitmap_set_all (p->used_map, true);
+  old_level = intr_disable ();
+  free_pages (p, 0, page_cnt);
+  intr_set_level (old_level);
+}
+
+/* Returns true if a request for PAGE_CNT pages with the given
+   FLAGS stays within POOL's limits.  Interrupts must be off. */
+static bool
+may_allocate (const struct pool *pool, enum palloc_flags flags,
+              size_t page_cnt)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!(flags & PAL_USER))
+    return true;
+  return (pool->user_cnt + page_cnt <= pool->user_limit
+          && pool->free_cnt >= page_cnt + pool->reserve);
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first one, or BITMAP_ERROR if no block is big
+   enough.  If ZERO, a single page that is already zero is
+   preferred.  Interrupts must be off. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt, bool zero)
+{
+  size_t page_idx = BITMAP_ERROR;
+  int order = 0, want;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  for (want = 0; want < PALLOC_ORDERS; want++)
+    if ((size_t) 1 << want >= page_cnt)
+      break;
+  if (want == PALLOC_ORDERS)
+    return BITMAP_ERROR;
+
+  if (zero && page_cnt == 1)
+    {
+      /* Prefer a page that the idle thread already zeroed. */
+      struct list *list = &pool->free_lists[0];
+      struct list_elem *e;
+      int i = 0;
+
+      for (e = list_begin (list); e != list_end (list) && i < ZERO_SCAN_MAX;
+           e = list_next (e), i++)
+        {
+          struct page_info *pi = list_entry (e, struct page_info, free_elem);
+          if (bitmap_test (pool->zero_map, pi - pool->info))
+            {
+              page_idx = pi - pool->info;
+              order = 0;
+              break;
+            }
+        }
+    }
+
+  if (page_idx == BITMAP_ERROR)
+    {
+      /* Take the first block of the smallest order that fits. */
+      for (order = want; order < PALLOC_ORDERS; order++)
+        if (!list_empty (&pool->free_lists[order]))
+          break;
+      if (order == PALLOC_ORDERS)
+        return BITMAP_ERROR;
+      page_idx = list_entry (list_front (&pool->free_lists[order]),
+                             struct page_info, free_elem) - pool->info;
+    }
+  list_remove (&pool->info[page_idx].free_elem);
+  pool->info[page_idx].order = -1;
+
+  /* Split it down to the order wanted, freeing upper halves. */
+  while (order > want)
+    {
+      size_t buddy_idx;
+
+      order--;
+      buddy_idx = page_idx + ((size_t) 1 << order);
+      pool->info[buddy_idx].order = order;
+      list_push_front (&pool->free_lists[order],
+                       &pool->info[buddy_idx].free_elem);
+    }
+  bitmap_set_multiple (pool->used_map, page_idx, (size_t) 1 << want, true);
+  pool->free_cnt -= (size_t) 1 << want;
+
+  /* Give back the pages beyond PAGE_CNT. */
+  if (page_cnt < (size_t) 1 << want)
+    free_pages (pool, page_idx + page_cnt, ((size_t) 1 << want) - page_cnt);
+
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT allocated pages in POOL starting at
+   PAGE_IDX, taking them off the user page count if need be.
+   Interrupts must be off. */
+static void
+release_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  size_t user_cnt = bitmap_count (pool->user_map, page_idx, page_cnt, true);
+
+  if (user_cnt > 0)
+    {
+      bitmap_set_multiple (pool->user_map, page_idx, page_cnt, false);
+      pool->user_cnt -= user_cnt;
+    }
+  free_pages (pool, page_idx, page_cnt);
+}
+
+/* Frees the PAGE_CNT pages in POOL starting at PAGE_IDX, which
+   need not form a single block.  Interrupts must be off. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
+
+  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  pool->free_cnt += page_cnt;
+
+  /* Carve the range into the largest aligned blocks it holds. */
+  while (page_cnt > 0)
+    {
+      int order = 0;
+
+      while (order + 1 < PALLOC_ORDERS
+             && page_idx % ((size_t) 1 << (order + 1)) == 0
+             && (size_t) 1 << (order + 1) <= page_cnt)
+        order++;
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Puts the block of 2**ORDER pages at PAGE_IDX in POOL on its
+   free list, first merging it with its buddy for as long as the
+   buddy is free. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order)
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+
+  while (order + 1 < PALLOC_ORDERS)
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+
+      if (buddy_idx + ((size_t) 1 << order) > page_cnt
+          || pool->info[buddy_idx].order != order)
+        break;
+      list_remove (&pool->info[buddy_idx].free_elem);
+      pool->info[buddy_idx].order = -1;
+      if (buddy_idx < page_idx)
+        page_idx = buddy_idx;
+      order++;
+    }
+  pool->info[page_idx].order = order;
+  list_push_front (&pool->free_lists[order], &pool->info[page_idx].free_elem);
+}
+
+/* Asks the shrinkers to free about PAGE_CNT pages.  Returns
+   true if they freed any, so that a failed request is worth
+   retrying.  Does nothing if the caller cannot sleep. */
+static bool
+run_shrinkers (size_t page_cnt)
+{
+  size_t freed = 0;
+  int i;
+
+  if (shrinker_cnt == 0 || intr_context ()
+      || intr_get_level () == INTR_OFF)
+    return false;
+
+  for (i = 0; i < shrinker_cnt && freed < page_cnt; i++)
+    freed += shrinkers[i] (page_cnt - freed);
+  shrink_calls++;
+  shrunk_pages += freed;
+  return freed > 0;
+}
+
+/* Zeroes the next free page in POOL that is not known to be
+   zero, if any.  Returns true if it zeroed a page.  Examines
+   ZERO_SCAN_CHUNK pages at a time with interrupts off. */
+static bool
+zero_one_page (struct pool *pool)
+{
+  size_t page_cnt = bitmap_size (pool->used_map);
+  size_t scanned;
+
+  for (scanned = 0; scanned < page_cnt; scanned += ZERO_SCAN_CHUNK)
+    {
+      enum intr_level old_level = intr_disable ();
+      size_t i;
+
+      for (i = 0; i < ZERO_SCAN_CHUNK && scanned + i < page_cnt; i++)
+        {
+          size_t page_idx = pool->zero_cursor;
+
+          pool->zero_cursor = (page_idx + 1) % page_cnt;
+          if (!bitmap_test (pool->used_map, page_idx)
+              && !bitmap_test (pool->zero_map, page_idx))
+            {
+              memset (pool->base + PGSIZE * page_idx, 0, PGSIZE);
+              bitmap_mark (pool->zero_map, page_idx);
+              idle_zeroed++;
+              intr_set_level (old_level);
+              return true;
+            }
+        }
+      intr_set_level (old_level);
+    }
+  return false;
 }
 
 /* Returns true if PAGE was allocated from POOL,
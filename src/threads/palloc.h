@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,20 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* A shrinker: frees about PAGE_CNT pages that a cache holds and
+   returns the number of pages actually freed. */
+typedef size_t palloc_shrink_func (size_t page_cnt);
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+void palloc_free_batch (void **pages, size_t page_cnt);
+size_t palloc_free_cnt (enum palloc_flags);
+bool palloc_memory_idle (void);
+void palloc_register_shrinker (palloc_shrink_func *);
+bool palloc_zero_free_page (void);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
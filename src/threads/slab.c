@@ -0,0 +1,275 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/interrupt.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A slab allocator.
+
+   malloc() rounds every request up to a power of 2, so a
+   530-byte structure occupies a 1 kB block and nearly half of
+   the memory is wasted.  An object cache instead carves
+   page-sized "slabs" into objects of exactly one size, so that
+   only the tail of each page goes unused.
+
+   Each slab begins with a header, followed by an array that
+   links its free objects by index, followed by the objects.
+   A cache keeps the slabs that still have free objects on its
+   `partial' list; full slabs are on no list.  When a slab
+   becomes entirely free it is kept for reuse if it is the
+   cache's only empty slab, and returned to the page allocator
+   otherwise.
+
+   If a cache has a constructor, it is applied to each object
+   once, when its slab is created, and objects must be returned
+   to the cache in their constructed state.  Objects in caches
+   without a constructor have undefined contents. */
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* End of a slab's free list. */
+#define SLAB_END UINT8_MAX
+
+/* Object cache. */
+struct kmem_cache
+  {
+    char name[16];              /* Name, for statistics. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t obj_cnt;             /* Number of objects in a slab. */
+    size_t obj_ofs;             /* Offset of first object in slab. */
+    void (*ctor) (void *);      /* Constructor, or null. */
+    struct list partial;        /* Slabs with free objects. */
+    size_t empty_cnt;           /* Number of entirely free slabs. */
+    struct lock lock;           /* Protects all of the above. */
+    struct list_elem elem;      /* Element in `all_caches'. */
+
+    /* Statistics. */
+    size_t slab_cnt;            /* Slabs allocated. */
+    size_t in_use;              /* Objects allocated. */
+    long long alloc_cnt;        /* Total calls to kmem_cache_alloc(). */
+  };
+
+/* Slab header, at the start of each slab's page. */
+struct slab
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in cache's `partial'. */
+    size_t free_cnt;            /* Number of free objects. */
+    uint8_t free_head;          /* Index of first free object. */
+    uint8_t free_next[];        /* Next free object, by index. */
+  };
+
+/* All object caches, for statistics. */
+static struct list all_caches = LIST_INITIALIZER (all_caches);
+
+static struct slab *slab_create (struct kmem_cache *);
+static struct slab *obj_to_slab (struct kmem_cache *, void *);
+static void *slab_to_obj (struct slab *, size_t idx);
+
+/* Creates and returns a cache of SIZE-byte objects named NAME,
+   which are constructed with CTOR if it is non-null.  SIZE must
+   be small enough that a slab holds at least two objects.
+   Returns a null pointer if memory is not available. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, void (*ctor) (void *))
+{
+  struct kmem_cache *c;
+  enum intr_level old_level;
+
+  ASSERT (name != NULL);
+  ASSERT (size > 0);
+
+  c = malloc (sizeof *c);
+  if (c == NULL)
+    return NULL;
+
+  /* Keep objects word-aligned, then fit as many of them as
+     possible, along with their free_next[] entries, after the
+     slab header. */
+  size = ROUND_UP (size, sizeof (uint32_t));
+  c->obj_cnt = (PGSIZE - sizeof (struct slab)) / (size + 1);
+  if (c->obj_cnt >= SLAB_END)
+    c->obj_cnt = SLAB_END - 1;
+  while (ROUND_UP (sizeof (struct slab) + c->obj_cnt, sizeof (uint32_t))
+         + c->obj_cnt * size > PGSIZE)
+    c->obj_cnt--;
+  ASSERT (c->obj_cnt >= 2);
+
+  strlcpy (c->name, name, sizeof c->name);
+  c->obj_size = size;
+  c->obj_ofs = ROUND_UP (sizeof (struct slab) + c->obj_cnt,
+                         sizeof (uint32_t));
+  c->ctor = ctor;
+  list_init (&c->partial);
+  c->empty_cnt = 0;
+  lock_init (&c->lock);
+  c->slab_cnt = 0;
+  c->in_use = 0;
+  c->alloc_cnt = 0;
+
+  old_level = intr_disable ();
+  list_push_back (&all_caches, &c->elem);
+  intr_set_level (old_level);
+  return c;
+}
+
+/* Obtains and returns an object from cache C.
+   Returns a null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c)
+{
+  struct slab *s;
+  void *obj;
+
+  ASSERT (c != NULL);
+
+  lock_acquire (&c->lock);
+  if (list_empty (&c->partial))
+    {
+      s = slab_create (c);
+      if (s == NULL)
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial, &s->elem);
+      c->empty_cnt++;
+    }
+
+  /* Take the first free object of the first partial slab. */
+  s = list_entry (list_front (&c->partial), struct slab, elem);
+  if (s->free_cnt == c->obj_cnt)
+    c->empty_cnt--;
+  obj = slab_to_obj (s, s->free_head);
+  s->free_head = s->free_next[s->free_head];
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+  c->in_use++;
+  c->alloc_cnt++;
+  lock_release (&c->lock);
+
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C with
+   kmem_cache_alloc(), to C.  A null OBJ is ignored. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj)
+{
+  struct slab *s;
+  size_t idx;
+
+  if (obj == NULL)
+    return;
+
+  s = obj_to_slab (c, obj);
+  idx = ((uint8_t *) obj - ((uint8_t *) s + c->obj_ofs)) / c->obj_size;
+
+#ifndef NDEBUG
+  /* Clear the object to help detect use-after-free bugs, unless
+     it must stay constructed. */
+  if (c->ctor == NULL)
+    memset (obj, 0xcc, c->obj_size);
+#endif
+
+  lock_acquire (&c->lock);
+  s->free_next[idx] = s->free_head;
+  s->free_head = idx;
+  if (s->free_cnt++ == 0)
+    list_push_front (&c->partial, &s->elem);
+  c->in_use--;
+
+  /* Keep one empty slab around to absorb alloc/free churn, but
+     give any others back to the page allocator. */
+  if (s->free_cnt == c->obj_cnt && c->empty_cnt++ > 0)
+    {
+      list_remove (&s->elem);
+      c->empty_cnt--;
+      c->slab_cnt--;
+      palloc_free_page (s);
+    }
+  lock_release (&c->lock);
+}
+
+/* Prints statistics for every object cache. */
+void
+kmem_cache_print_stats (void)
+{
+  struct list_elem *e;
+
+  for (e = list_begin (&all_caches); e != list_end (&all_caches);
+       e = list_next (e))
+    {
+      struct kmem_cache *c = list_entry (e, struct kmem_cache, elem);
+      printf ("Slab %s: %zu-byte objects, %zu per slab, %zu slabs, "
+              "%zu in use, %lld allocated\n",
+              c->name, c->obj_size, c->obj_cnt, c->slab_cnt,
+              c->in_use, c->alloc_cnt);
+    }
+}
+
+/* Allocates a new slab for cache C, constructs its objects and
+   links them all into its free list.  C's lock must be held.
+   Returns a null pointer if memory is not available. */
+static struct slab *
+slab_create (struct kmem_cache *c)
+{
+  struct slab *s;
+  size_t i;
+
+  ASSERT (lock_held_by_current_thread (&c->lock));
+
+  s = palloc_get_page (0);
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->obj_cnt;
+  s->free_head = 0;
+  for (i = 0; i < c->obj_cnt; i++)
+    {
+      s->free_next[i] = i + 1 < c->obj_cnt ? i + 1 : SLAB_END;
+      if (c->ctor != NULL)
+        c->ctor (slab_to_obj (s, i));
+    }
+  c->slab_cnt++;
+  return s;
+}
+
+/* Returns the slab of cache C that OBJ is inside. */
+static struct slab *
+obj_to_slab (struct kmem_cache *c, void *obj)
+{
+  struct slab *s = pg_round_down (obj);
+
+  /* Check that the slab is valid and belongs to C. */
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (s->cache == c);
+
+  /* Check that the object is properly aligned for the slab. */
+  ASSERT (pg_ofs (obj) >= c->obj_ofs);
+  ASSERT ((pg_ofs (obj) - c->obj_ofs) % c->obj_size == 0);
+
+  return s;
+}
+
+/* Returns the IDX'th object within slab S. */
+static void *
+slab_to_obj (struct slab *s, size_t idx)
+{
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT (idx < s->cache->obj_cnt);
+  return (uint8_t *) s + s->cache->obj_ofs + idx * s->cache->obj_size;
+}
@@ -27,10 +27,40 @@
 */
 
 #include "threads/synch.h"
+#include <inttypes.h>
 #include <stdio.h>
 #include <string.h>
 #include "threads/interrupt.h"
 #include "threads/thread.h"
+#include "devices/timer.h"
+
+/* Maximum length of a chain of locks and holders that a priority
+   donation is passed along. */
+#define DONATION_DEPTH_MAX 8
+
+static bool thread_priority_less (const struct list_elem *,
+                                  const struct list_elem *, void *aux);
+static bool waiter_priority_less (const struct list_elem *,
+                                  const struct list_elem *, void *aux);
+
+/* Lock profiler.  Locks named with lock_set_name() get a profile
+   that, if lock_profiling is true, records how often they are
+   acquired and how long threads wait for and hold them. */
+bool lock_profiling;
+
+struct lock_profile
+  {
+    struct lock_stat stat;      /* Statistics gathered so far. */
+    int64_t acquired_at;        /* When the holder acquired the lock. */
+  };
+
+#define LOCK_PROFILE_CNT 16     /* Maximum number of profiled locks. */
+static struct lock_profile lock_profiles[LOCK_PROFILE_CNT];
+static int lock_profile_cnt;
+
+static void profile_acquired (struct lock_profile *, bool contended,
+                              int64_t wait);
+static void profile_released (struct lock_profile *);
 
 /* Initializes semaphore SEMA to VALUE.  A semaphore is a
    nonnegative integer along with two atomic operators for
@@ -102,7 +132,9 @@ sema_try_down (struct semaphore *sema)
 }
 
 /* Up or "V" operation on a semaphore.  Increments SEMA's value
-   and wakes up one thread of those waiting for SEMA, if any.
+   and wakes up the highest-priority thread of those waiting for
+   SEMA, if any.  Yields if the woken thread has a higher priority
+   than the running thread.
 
    This function may be called from an interrupt handler. */
 void
@@ -114,10 +146,18 @@ sema_up (struct semaphore *sema)
 
   old_level = intr_disable ();
   if (!list_empty (&sema->waiters)) 
-    thread_unblock (list_entry (list_pop_front (&sema->waiters),
-                                struct thread, elem));
+    {
+      /* Waiters' priorities can change through donation while
+         they wait, so pick the highest one now instead of keeping
+         the list sorted. */
+      struct list_elem *e = list_max (&sema->waiters,
+                                      thread_priority_less, NULL);
+      list_remove (e);
+      thread_unblock (list_entry (e, struct thread, elem));
+    }
   sema->value++;
   intr_set_level (old_level);
+  thread_check_preemption ();
 }
 
 static void sema_test_helper (void *sema_);
@@ -178,13 +218,37 @@ lock_init (struct lock *lock)
   ASSERT (lock != NULL);
 
   lock->holder = NULL;
+  lock->profile = NULL;
   sema_init (&lock->semaphore, 1);
 }
 
+/* Names LOCK NAME for the lock profiler, which then reports its
+   contention statistics.  NAME must remain valid as long as LOCK
+   does.  Only the first LOCK_PROFILE_CNT locks named get a
+   profile. */
+void
+lock_set_name (struct lock *lock, const char *name)
+{
+  ASSERT (lock != NULL);
+  ASSERT (name != NULL);
+
+  if (lock->profile == NULL && lock_profile_cnt < LOCK_PROFILE_CNT)
+    {
+      lock->profile = &lock_profiles[lock_profile_cnt++];
+      strlcpy (lock->profile->stat.name, name,
+               sizeof lock->profile->stat.name);
+    }
+}
+
 /* Acquires LOCK, sleeping until it becomes available if
    necessary.  The lock must not already be held by the current
    thread.
 
+   While waiting, the current thread donates its priority to the
+   holder of LOCK, and on along the chain of locks that holder is
+   itself waiting for, so that a lower-priority holder cannot be
+   kept off the CPU by medium-priority threads.
+
    This function may sleep, so it must not be called within an
    interrupt handler.  This function may be called with
    interrupts disabled, but interrupts will be turned back on if
@@ -192,12 +256,43 @@ lock_init (struct lock *lock)
 void
 lock_acquire (struct lock *lock)
 {
+  struct thread *cur = thread_current ();
+  bool profiled, contended = false;
+  int64_t start = 0;
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (!intr_context ());
   ASSERT (!lock_held_by_current_thread (lock));
 
+  profiled = lock_profiling && lock->profile != NULL;
+  old_level = intr_disable ();
+  if (profiled)
+    {
+      contended = lock->holder != NULL;
+      start = timer_ticks ();
+    }
+  if (lock->holder != NULL)
+    {
+      struct lock *l = lock;
+      int depth;
+
+      cur->waiting_lock = lock;
+      for (depth = 0; l != NULL && l->holder != NULL
+             && depth < DONATION_DEPTH_MAX; depth++)
+        {
+          thread_donate_priority (l->holder, cur->priority);
+          l = l->holder->waiting_lock;
+        }
+    }
+
   sema_down (&lock->semaphore);
-  lock->holder = thread_current ();
+  cur->waiting_lock = NULL;
+  lock->holder = cur;
+  list_push_back (&cur->locks_held, &lock->elem);
+  if (profiled)
+    profile_acquired (lock->profile, contended, timer_ticks () - start);
+  intr_set_level (old_level);
 }
 
 /* Tries to acquires LOCK and returns true if successful or false
@@ -216,11 +311,19 @@ lock_try_acquire (struct lock *lock)
 
   success = sema_try_down (&lock->semaphore);
   if (success)
-    lock->holder = thread_current ();
+    {
+      enum intr_level old_level = intr_disable ();
+      lock->holder = thread_current ();
+      list_push_back (&lock->holder->locks_held, &lock->elem);
+      if (lock_profiling && lock->profile != NULL)
+        profile_acquired (lock->profile, false, 0);
+      intr_set_level (old_level);
+    }
   return success;
 }
 
 /* Releases LOCK, which must be owned by the current thread.
+   Gives up any priority donated by threads waiting for LOCK.
 
    An interrupt handler cannot acquire a lock, so it does not
    make sense to try to release a lock within an interrupt
@@ -228,13 +331,94 @@ lock_try_acquire (struct lock *lock)
 void
 lock_release (struct lock *lock) 
 {
+  enum intr_level old_level;
+
   ASSERT (lock != NULL);
   ASSERT (lock_held_by_current_thread (lock));
 
+  old_level = intr_disable ();
+  if (lock_profiling && lock->profile != NULL)
+    profile_released (lock->profile);
+  list_remove (&lock->elem);
   lock->holder = NULL;
+  thread_update_priority (thread_current ());
+  intr_set_level (old_level);
   sema_up (&lock->semaphore);
 }
 
+/* Records in PROFILE that its lock was acquired after waiting
+   WAIT ticks, which counts as contention if CONTENDED.
+   Interrupts must be off. */
+static void
+profile_acquired (struct lock_profile *profile, bool contended, int64_t wait)
+{
+  struct lock_stat *stat = &profile->stat;
+  int bucket;
+
+  stat->acquired++;
+  if (contended)
+    stat->contended++;
+  stat->wait_ticks += wait;
+  if (wait > stat->max_wait_ticks)
+    stat->max_wait_ticks = wait;
+  for (bucket = 0; wait > 0 && bucket < LOCK_STAT_BUCKETS - 1; bucket++)
+    wait >>= 1;
+  stat->wait_hist[bucket]++;
+  profile->acquired_at = timer_ticks ();
+}
+
+/* Records in PROFILE that its lock is being released.
+   Interrupts must be off. */
+static void
+profile_released (struct lock_profile *profile)
+{
+  struct lock_stat *stat = &profile->stat;
+  int64_t hold = timer_ticks () - profile->acquired_at;
+
+  stat->hold_ticks += hold;
+  if (hold > stat->max_hold_ticks)
+    stat->max_hold_ticks = hold;
+}
+
+/* Copies the statistics of the INDEXth profiled lock into STAT.
+   Returns false if there is no such lock. */
+bool
+lock_get_stat (int index, struct lock_stat *stat)
+{
+  enum intr_level old_level;
+
+  if (index < 0 || index >= lock_profile_cnt)
+    return false;
+  old_level = intr_disable ();
+  *stat = lock_profiles[index].stat;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Prints lock profiler statistics. */
+void
+lock_print_stats (void)
+{
+  struct lock_stat stat;
+  int i, b;
+
+  if (!lock_profiling)
+    return;
+  for (i = 0; lock_get_stat (i, &stat); i++)
+    {
+      printf ("Lock %s: %"PRIu32" acquired, %"PRIu32" contended, "
+              "waited %"PRIu32" ticks (max %"PRIu32"), "
+              "held %"PRIu32" ticks (max %"PRIu32")\n",
+              stat.name, stat.acquired, stat.contended,
+              stat.wait_ticks, stat.max_wait_ticks,
+              stat.hold_ticks, stat.max_hold_ticks);
+      printf ("  wait histogram:");
+      for (b = 0; b < LOCK_STAT_BUCKETS; b++)
+        printf (" %"PRIu32, stat.wait_hist[b]);
+      printf ("\n");
+    }
+}
+
 /* Returns true if the current thread holds LOCK, false
    otherwise.  (Note that testing whether some other thread holds
    a lock would be racy.) */
@@ -251,6 +435,7 @@ struct semaphore_elem
   {
     struct list_elem elem;              /* List element. */
     struct semaphore semaphore;         /* This semaphore. */
+    struct thread *thread;              /* Thread waiting on it. */
   };
 
 /* Initializes condition variable COND.  A condition variable
@@ -295,6 +480,7 @@ cond_wait (struct condition *cond, struct lock *lock)
   ASSERT (lock_held_by_current_thread (lock));
   
   sema_init (&waiter.semaphore, 0);
+  waiter.thread = thread_current ();
   list_push_back (&cond->waiters, &waiter.elem);
   lock_release (lock);
   sema_down (&waiter.semaphore);
@@ -302,7 +488,8 @@ cond_wait (struct condition *cond, struct lock *lock)
 }
 
 /* If any threads are waiting on COND (protected by LOCK), then
-   this function signals one of them to wake up from its wait.
+   this function signals the one with the highest priority to
+   wake up from its wait.
    LOCK must be held before calling this function.
 
    An interrupt handler cannot acquire a lock, so it does not
@@ -317,8 +504,12 @@ cond_signal (struct condition *cond, struct lock *lock UNUSED)
   ASSERT (lock_held_by_current_thread (lock));
 
   if (!list_empty (&cond->waiters)) 
-    sema_up (&list_entry (list_pop_front (&cond->waiters),
-                          struct semaphore_elem, elem)->semaphore);
+    {
+      struct list_elem *e = list_max (&cond->waiters,
+                                      waiter_priority_less, NULL);
+      list_remove (e);
+      sema_up (&list_entry (e, struct semaphore_elem, elem)->semaphore);
+    }
 }
 
 /* Wakes up all threads, if any, waiting on COND (protected by
@@ -336,3 +527,331 @@ cond_broadcast (struct condition *cond, struct lock *lock)
   while (!list_empty (&cond->waiters))
     cond_signal (cond, lock);
 }
+
+/* Initializes readers-writer lock RWLOCK.  Writers are
+   preferred: once a writer is waiting, new readers wait behind
+   it, so that a stream of readers cannot starve writers.  Among
+   waiting writers, the one with the highest priority goes
+   first. */
+void
+rwlock_init (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  lock_init (&rwlock->lock);
+  cond_init (&rwlock->readers_ok);
+  cond_init (&rwlock->writers_ok);
+  rwlock->readers = 0;
+  rwlock->waiting_writers = 0;
+  rwlock->writer = NULL;
+}
+
+/* Acquires RWLOCK for reading, sleeping while a writer holds it
+   or is waiting for it.  The current thread must not already
+   hold RWLOCK.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_read (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rwlock->lock);
+  ASSERT (rwlock->writer != thread_current ());
+  while (rwlock->writer != NULL || rwlock->waiting_writers > 0)
+    cond_wait (&rwlock->readers_ok, &rwlock->lock);
+  rwlock->readers++;
+  lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, which the current thread holds for reading. */
+void
+rwlock_release_read (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  lock_acquire (&rwlock->lock);
+  ASSERT (rwlock->readers > 0);
+  if (--rwlock->readers == 0 && rwlock->waiting_writers > 0)
+    cond_signal (&rwlock->writers_ok, &rwlock->lock);
+  lock_release (&rwlock->lock);
+}
+
+/* Acquires RWLOCK for writing, sleeping until no other thread
+   holds it.  The current thread must not already hold RWLOCK.
+
+   This function may sleep, so it must not be called within an
+   interrupt handler. */
+void
+rwlock_acquire_write (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+  ASSERT (!intr_context ());
+
+  lock_acquire (&rwlock->lock);
+  ASSERT (rwlock->writer != thread_current ());
+  rwlock->waiting_writers++;
+  while (rwlock->writer != NULL || rwlock->readers > 0)
+    cond_wait (&rwlock->writers_ok, &rwlock->lock);
+  rwlock->waiting_writers--;
+  rwlock->writer = thread_current ();
+  lock_release (&rwlock->lock);
+}
+
+/* Releases RWLOCK, which the current thread holds for writing,
+   handing it to the next writer if there is one and otherwise to
+   all waiting readers. */
+void
+rwlock_release_write (struct rwlock *rwlock)
+{
+  ASSERT (rwlock != NULL);
+
+  lock_acquire (&rwlock->lock);
+  ASSERT (rwlock->writer == thread_current ());
+  rwlock->writer = NULL;
+  if (rwlock->waiting_writers > 0)
+    cond_signal (&rwlock->writers_ok, &rwlock->lock);
+  else
+    cond_broadcast (&rwlock->readers_ok, &rwlock->lock);
+  lock_release (&rwlock->lock);
+}
+
+/* State shared by rwlock_self_test() and its helper threads. */
+struct rwlock_test
+  {
+    struct rwlock rwlock;       /* Lock under test. */
+    struct semaphore done;      /* Upped by each helper at exit. */
+    int readers;                /* # of helpers reading now. */
+    int writers;                /* # of helpers writing now. */
+    int max_readers;            /* Most helpers ever reading at once. */
+  };
+
+static void rwlock_test_reader (void *test_);
+static void rwlock_test_writer (void *test_);
+
+/* Self-test for readers-writer locks.  Runs reader and writer
+   threads that yield while holding the lock, first checking that
+   readers share it, then that writers have it to themselves. */
+void
+rwlock_self_test (void)
+{
+  struct rwlock_test test;
+  int i;
+
+  printf ("Testing readers-writer locks...");
+  rwlock_init (&test.rwlock);
+  sema_init (&test.done, 0);
+  test.readers = test.writers = test.max_readers = 0;
+
+  for (i = 0; i < 4; i++)
+    thread_create ("rw-reader", PRI_DEFAULT, rwlock_test_reader, &test);
+  for (i = 0; i < 4; i++)
+    sema_down (&test.done);
+  ASSERT (test.max_readers > 1);
+
+  for (i = 0; i < 4; i++)
+    {
+      thread_create ("rw-reader", PRI_DEFAULT, rwlock_test_reader, &test);
+      thread_create ("rw-writer", PRI_DEFAULT, rwlock_test_writer, &test);
+    }
+  for (i = 0; i < 8; i++)
+    sema_down (&test.done);
+  printf ("done.\n");
+}
+
+/* Reader thread used by rwlock_self_test(). */
+static void
+rwlock_test_reader (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < 10; i++)
+    {
+      rwlock_acquire_read (&test->rwlock);
+      ASSERT (test->writers == 0);
+      if (++test->readers > test->max_readers)
+        test->max_readers = test->readers;
+      thread_yield ();
+      ASSERT (test->writers == 0);
+      test->readers--;
+      rwlock_release_read (&test->rwlock);
+    }
+  sema_up (&test->done);
+}
+
+/* Writer thread used by rwlock_self_test(). */
+static void
+rwlock_test_writer (void *test_)
+{
+  struct rwlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < 10; i++)
+    {
+      rwlock_acquire_write (&test->rwlock);
+      ASSERT (test->readers == 0 && test->writers == 0);
+      test->writers++;
+      thread_yield ();
+      ASSERT (test->readers == 0 && test->writers == 1);
+      test->writers--;
+      rwlock_release_write (&test->rwlock);
+      thread_yield ();
+    }
+  sema_up (&test->done);
+}
+
+/* Initializes sequence lock SEQLOCK.
+
+   A reader brackets its reads like this, and must not act on
+   what it read until the loop exits:
+
+     do
+       {
+         start = seqlock_read_begin (&seqlock);
+         ...read the protected data...
+       }
+     while (seqlock_read_retry (&seqlock, start));
+
+   Writers must be serialized by other means, for example by
+   being the only code that writes the data, or by a lock.  The
+   write side runs with interrupts off, so on a uniprocessor a
+   thread never finds a write half done, and a reader has to
+   retry only if an interrupt handler wrote the data while it was
+   reading. */
+void
+seqlock_init (struct seqlock *seqlock)
+{
+  ASSERT (seqlock != NULL);
+
+  seqlock->seq = 0;
+}
+
+/* Starts a read of the data protected by SEQLOCK and returns a
+   value to pass to seqlock_read_retry(). */
+unsigned
+seqlock_read_begin (const struct seqlock *seqlock)
+{
+  /* An odd value never matches, so a read that starts during a
+     write is retried. */
+  unsigned start = seqlock->seq & ~1u;
+  barrier ();
+  return start;
+}
+
+/* Returns true if the data protected by SEQLOCK may have changed
+   since the seqlock_read_begin() that returned START, in which
+   case the caller must read it again. */
+bool
+seqlock_read_retry (const struct seqlock *seqlock, unsigned start)
+{
+  barrier ();
+  return seqlock->seq != start;
+}
+
+/* Starts a write of the data protected by SEQLOCK.  Turns off
+   interrupts and returns the previous interrupt level, to pass
+   to seqlock_write_end(). */
+enum intr_level
+seqlock_write_begin (struct seqlock *seqlock)
+{
+  enum intr_level old_level = intr_disable ();
+
+  ASSERT ((seqlock->seq & 1) == 0);
+  seqlock->seq++;
+  barrier ();
+  return old_level;
+}
+
+/* Ends a write of the data protected by SEQLOCK and restores the
+   interrupt level OLD_LEVEL. */
+void
+seqlock_write_end (struct seqlock *seqlock, enum intr_level old_level)
+{
+  barrier ();
+  seqlock->seq++;
+  intr_set_level (old_level);
+}
+
+/* State shared by seqlock_self_test() and its helper thread. */
+struct seqlock_test
+  {
+    struct seqlock seqlock;     /* Lock under test. */
+    struct semaphore done;      /* Upped by the writer at exit. */
+    int a, b;                   /* Always equal, as seen by readers. */
+  };
+
+static void seqlock_test_writer (void *test_);
+
+/* Self-test for sequence locks.  A writer thread keeps changing a
+   pair of values that must stay equal while this thread reads
+   them, yielding in between. */
+void
+seqlock_self_test (void)
+{
+  struct seqlock_test test;
+  int i;
+
+  printf ("Testing sequence locks...");
+  seqlock_init (&test.seqlock);
+  sema_init (&test.done, 0);
+  test.a = test.b = 0;
+  thread_create ("seq-writer", PRI_DEFAULT, seqlock_test_writer, &test);
+  for (i = 0; i < 100; i++)
+    {
+      unsigned start;
+      int a, b;
+
+      do
+        {
+          start = seqlock_read_begin (&test.seqlock);
+          a = test.a;
+          thread_yield ();
+          b = test.b;
+        }
+      while (seqlock_read_retry (&test.seqlock, start));
+      ASSERT (a == b);
+    }
+  sema_down (&test.done);
+  printf ("done.\n");
+}
+
+/* Writer thread used by seqlock_self_test(). */
+static void
+seqlock_test_writer (void *test_)
+{
+  struct seqlock_test *test = test_;
+  int i;
+
+  for (i = 0; i < 100; i++)
+    {
+      enum intr_level old_level = seqlock_write_begin (&test->seqlock);
+      test->a++;
+      test->b++;
+      seqlock_write_end (&test->seqlock, old_level);
+      thread_yield ();
+    }
+  sema_up (&test->done);
+}
+
+/* Returns true if the thread whose `elem' is A has a lower
+   priority than the one whose `elem' is B. */
+static bool
+thread_priority_less (const struct list_elem *a, const struct list_elem *b,
+                      void *aux UNUSED)
+{
+  return (list_entry (a, struct thread, elem)->priority
+          < list_entry (b, struct thread, elem)->priority);
+}
+
+/* Returns true if condition variable waiter A has a lower
+   priority than waiter B. */
+static bool
+waiter_priority_less (const struct list_elem *a, const struct list_elem *b,
+                      void *aux UNUSED)
+{
+  return (list_entry (a, struct semaphore_elem, elem)->thread->priority
+          < list_entry (b, struct semaphore_elem, elem)->thread->priority);
+}
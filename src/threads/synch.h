@@ -2,7 +2,9 @@
 #define THREADS_SYNCH_H
 
 #include <list.h>
+#include <lock-stat.h>
 #include <stdbool.h>
+#include "threads/interrupt.h"
 
 /* A counting semaphore. */
 struct semaphore 
@@ -20,11 +22,20 @@ void sema_self_test (void);
 /* Lock. */
 struct lock 
   {
-    struct thread *holder;      /* Thread holding lock (for debugging). */
+    struct thread *holder;      /* Thread holding lock. */
     struct semaphore semaphore; /* Binary semaphore controlling access. */
+    struct list_elem elem;      /* Element in holder's `locks_held'. */
+    struct lock_profile *profile; /* Contention statistics, if named. */
   };
 
+/* If true, named locks record contention statistics.
+   Controlled by kernel command-line option "-lockprof". */
+extern bool lock_profiling;
+
 void lock_init (struct lock *);
+void lock_set_name (struct lock *, const char *name);
+bool lock_get_stat (int index, struct lock_stat *);
+void lock_print_stats (void);
 void lock_acquire (struct lock *);
 bool lock_try_acquire (struct lock *);
 void lock_release (struct lock *);
@@ -41,6 +52,40 @@ void cond_wait (struct condition *, struct lock *);
 void cond_signal (struct condition *, struct lock *);
 void cond_broadcast (struct condition *, struct lock *);
 
+/* Readers-writer lock.  Any number of readers or a single writer
+   may hold it.  Waiting writers go before new readers. */
+struct rwlock
+  {
+    struct lock lock;           /* Protects the members below. */
+    struct condition readers_ok; /* Readers may proceed. */
+    struct condition writers_ok; /* A writer may proceed. */
+    int readers;                /* # of readers holding the lock. */
+    int waiting_writers;        /* # of writers waiting. */
+    struct thread *writer;      /* Writer holding the lock, if any. */
+  };
+
+void rwlock_init (struct rwlock *);
+void rwlock_acquire_read (struct rwlock *);
+void rwlock_release_read (struct rwlock *);
+void rwlock_acquire_write (struct rwlock *);
+void rwlock_release_write (struct rwlock *);
+void rwlock_self_test (void);
+
+/* Sequence lock, for small values that are read much more often
+   than they are written.  Readers take no lock; they retry if a
+   write happened meanwhile. */
+struct seqlock
+  {
+    unsigned seq;               /* Odd while a write is in progress. */
+  };
+
+void seqlock_init (struct seqlock *);
+unsigned seqlock_read_begin (const struct seqlock *);
+bool seqlock_read_retry (const struct seqlock *, unsigned start);
+enum intr_level seqlock_write_begin (struct seqlock *);
+void seqlock_write_end (struct seqlock *, enum intr_level);
+void seqlock_self_test (void);
+
 /* Optimization barrier.
 
    The compiler will not reorder operations across an
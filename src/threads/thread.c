@@ -5,11 +5,14 @@
 #include <stdio.h>
 #include <string.h>
 #include <filesys/file.h>
+#include "devices/timer.h"
+#include "threads/fixed_point.h"
 #include "threads/flags.h"
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -23,9 +26,14 @@
    of thread.h for details. */
 #define THREAD_MAGIC 0xcd6abf4b
 
-/* List of processes in THREAD_READY state, that is, processes
-   that are ready to run but not actually running. */
-static struct list ready_list;
+/* Processes in THREAD_READY state, that is, processes that are
+   ready to run but not actually running.  There is one FIFO run
+   queue per priority, and bit P of ready_bitmap is set if and
+   only if ready_queues[P] is nonempty, so the highest ready
+   priority can be found with a bit scan. */
+static struct list ready_queues[PRI_MAX + 1];
+static uint32_t ready_bitmap[(PRI_MAX + 32) / 32];
+static int ready_thread_cnt;    /* # of threads in the run queues. */
 
 /* List of all processes.  Processes are added to this list
    when they are first scheduled and removed when they exit. */
@@ -43,6 +51,9 @@ static struct lock tid_lock;
 // global file lock for file manipulation
 static struct lock file_lock;
 
+/* Object cache for child_thread records. */
+static struct kmem_cache *child_thread_cache;
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -65,8 +76,23 @@ static unsigned thread_ticks;   /* # of timer ticks since last yield. */
    Controlled by kernel command-line option "-o mlfqs". */
 bool thread_mlfqs;
 
+/* Multi-level feedback queue scheduler.  Only the running
+   thread's recent_cpu changes from one tick to the next, so every
+   4 ticks only its priority needs to be recomputed.  The other
+   threads' priorities change only when recent_cpu decays, once
+   per second. */
+#define MLFQS_PRIORITY_TICKS 4  /* # of ticks between updates. */
+static fixed_t load_avg;        /* System load average. */
+
 static void kernel_thread (thread_func *, void *aux);
 
+static void ready_queue_push (struct thread *);
+static void ready_queue_remove (struct thread *);
+static int ready_queue_max_priority (void);
+static void mlfqs_tick (struct thread *);
+static void mlfqs_update_priority (struct thread *);
+static void set_effective_priority (struct thread *, int priority);
+
 static void idle (void *aux UNUSED);
 static struct thread *running_thread (void);
 static struct thread *next_thread_to_run (void);
@@ -93,15 +119,17 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
   lock_init(&file_lock);
-  list_init (&ready_list);
+  lock_set_name(&file_lock, "file_lock");
+  for (i = 0; i <= PRI_MAX; i++)
+    list_init (&ready_queues[i]);
   list_init (&all_list);
 
-  list_init(&sleep_list);
-
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
@@ -115,6 +143,13 @@ thread_init (void)
 void
 thread_start (void) 
 {
+  /* Create the object cache for child_thread records, which
+     thread_create() needs from now on. */
+  child_thread_cache = kmem_cache_create ("child_thread",
+                                          sizeof (struct child_thread), NULL);
+  if (child_thread_cache == NULL)
+    PANIC ("can't create child_thread object cache");
+
   /* Create the idle thread. */
   struct semaphore idle_started;
   sema_init (&idle_started, 0);
@@ -144,11 +179,81 @@ thread_tick (void)
   else
     kernel_ticks++;
 
+  if (thread_mlfqs)
+    mlfqs_tick (t);
+
   /* Enforce preemption. */
   if (++thread_ticks >= TIME_SLICE)
     intr_yield_on_return ();
 }
 
+/* Does the multi-level feedback queue scheduler's bookkeeping
+   for a timer tick that interrupted CUR. */
+static void
+mlfqs_tick (struct thread *cur)
+{
+  int64_t ticks = timer_ticks ();
+
+  if (cur != idle_thread)
+    cur->recent_cpu = FP_ADD_MIX (cur->recent_cpu, 1);
+
+  if (ticks % TIMER_FREQ == 0)
+    {
+      /* Once per second, update the load average and decay every
+         thread's recent_cpu, which changes all priorities. */
+      int ready = ready_thread_cnt + (cur != idle_thread ? 1 : 0);
+      fixed_t twice_load, decay;
+      struct list_elem *e;
+
+      load_avg = FP_DIV_MIX (FP_ADD (FP_MULT_MIX (load_avg, 59),
+                                     FP_CONST (ready)), 60);
+      twice_load = FP_MULT_MIX (load_avg, 2);
+      decay = FP_DIV (twice_load, FP_ADD_MIX (twice_load, 1));
+      for (e = list_begin (&all_list); e != list_end (&all_list);
+           e = list_next (e))
+        {
+          struct thread *t = list_entry (e, struct thread, allelem);
+          if (t == idle_thread)
+            continue;
+          t->recent_cpu = FP_ADD_MIX (FP_MULT (decay, t->recent_cpu),
+                                      t->nice);
+          mlfqs_update_priority (t);
+        }
+    }
+  else if (ticks % MLFQS_PRIORITY_TICKS == 0 && cur != idle_thread)
+    mlfqs_update_priority (cur);
+
+  if (ready_queue_max_priority () > cur->priority)
+    intr_yield_on_return ();
+}
+
+/* Recomputes T's priority from its recent_cpu and nice values,
+   moving T to the matching run queue if it is ready.  Interrupts
+   must be off. */
+static void
+mlfqs_update_priority (struct thread *t)
+{
+  int priority = PRI_MAX - FP_INT_PART (FP_DIV_MIX (t->recent_cpu, 4))
+                 - t->nice * 2;
+
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (priority < PRI_MIN)
+    priority = PRI_MIN;
+  else if (priority > PRI_MAX)
+    priority = PRI_MAX;
+  if (priority != t->priority)
+    set_effective_priority (t, priority);
+}
+
+/* Charges TICKS timer ticks that passed without a timer
+   interrupt to the idle thread.  Used by tickless idle. */
+void
+thread_add_idle_ticks (int64_t ticks)
+{
+  idle_ticks += ticks;
+}
+
 /* Prints thread statistics. */
 void
 thread_print_stats (void) 
@@ -169,9 +274,8 @@ thread_print_stats (void)
    scheduled.  Use a semaphore or some other form of
    synchronization if you need to ensure ordering.
 
-   The code provided sets the new thread's `priority' member to
-   PRIORITY, but no actual priority scheduling is implemented.
-   Priority scheduling is the goal of Problem 1-3. */
+   If the new thread has a higher priority than the running
+   thread, it preempts the running thread right away. */
 tid_t
 thread_create (const char *name, int priority,
                thread_func *function, void *aux) 
@@ -193,7 +297,7 @@ thread_create (const char *name, int priority,
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
   // allocate space for child thread struct
-  struct child_thread *ct = malloc(sizeof(struct child_thread));
+  struct child_thread *ct = kmem_cache_alloc(child_thread_cache);
   ct->tid = tid;
   // add the child thread struct to the childs of the current thread 
   list_push_back (&thread_current()->childs, &(ct->child_thread_elem));
@@ -215,6 +319,7 @@ thread_create (const char *name, int priority,
 
   /* Add to run queue. */
   thread_unblock (t);
+  thread_check_preemption ();
 
   return tid;
 }
@@ -239,10 +344,13 @@ thread_block (void)
    This is an error if T is not blocked.  (Use thread_yield() to
    make the running thread ready.)
 
-   This function does not preempt the running thread.  This can
-   be important: if the caller had disabled interrupts itself,
-   it may expect that it can atomically unblock a thread and
-   update other data. */
+   This function does not preempt the running thread, except
+   when called from an interrupt handler, where the switch is
+   deferred until the handler returns.  This can be important: if
+   the caller had disabled interrupts itself, it may expect that
+   it can atomically unblock a thread and update other data.
+   Call thread_check_preemption() afterward to let a
+   higher-priority thread run. */
 void
 thread_unblock (struct thread *t) 
 {
@@ -252,11 +360,30 @@ thread_unblock (struct thread *t)
 
   old_level = intr_disable ();
   ASSERT (t->status == THREAD_BLOCKED);
-  list_push_back (&ready_list, &t->elem);
+  ready_queue_push (t);
   t->status = THREAD_READY;
+  if (intr_context () && t->priority > running_thread ()->priority)
+    intr_yield_on_return ();
   intr_set_level (old_level);
 }
 
+/* Yields the CPU if a thread with a higher priority than the
+   running thread is ready to run.  In an interrupt handler, the
+   yield happens when the handler returns.  Otherwise it happens
+   only if interrupts are on, so that callers that turned them
+   off keep running atomically; they are preempted no later than
+   at the end of the time slice. */
+void
+thread_check_preemption (void)
+{
+  if (ready_queue_max_priority () <= running_thread ()->priority)
+    return;
+  if (intr_context ())
+    intr_yield_on_return ();
+  else if (intr_get_level () == INTR_ON)
+    thread_yield ();
+}
+
 /* Returns the name of the running thread. */
 const char *
 thread_name (void) 
@@ -324,6 +451,7 @@ thread_exit (void)
 
     // up the child semaphore to stop parent thread from waiting
   sema_up(&thread_current()->child_sema);
+#ifdef USERPROG
   //close the executable file
   file_close(thread_current()->executable);
   // close all file that opened in the thread_current()
@@ -333,8 +461,9 @@ thread_exit (void)
   {
     struct file_node *f = list_entry (list_pop_front(files), struct file_node, file_elem);
     file_close(f->file);
-    free(f);
+    kmem_cache_free(file_node_cache, f);
   }
+#endif
 
 
   // printf("exit tid %d\n", thread_current()->tid);
@@ -359,7 +488,7 @@ thread_yield (void)
 
   old_level = intr_disable ();
   if (cur != idle_thread) 
-    list_push_back (&ready_list, &cur->elem);
+    ready_queue_push (cur);
   cur->status = THREAD_READY;
   schedule ();
   intr_set_level (old_level);
@@ -382,11 +511,92 @@ thread_foreach (thread_action_func *func, void *aux)
     }
 }
 
-/* Sets the current thread's priority to NEW_PRIORITY. */
+/* Sets the current thread's base priority to NEW_PRIORITY,
+   yielding if a ready thread now has a higher priority.  The
+   thread keeps running at any higher priority donated to it
+   until it releases the locks concerned.  Ignored by the
+   multi-level feedback queue scheduler, which sets priorities
+   itself. */
 void
 thread_set_priority (int new_priority) 
 {
-  thread_current ()->priority = new_priority;
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (PRI_MIN <= new_priority && new_priority <= PRI_MAX);
+
+  if (thread_mlfqs)
+    return;
+  old_level = intr_disable ();
+  cur->base_priority = new_priority;
+  thread_update_priority (cur);
+  intr_set_level (old_level);
+  thread_check_preemption ();
+}
+
+/* Sets T's priority to P, moving T to the matching run queue if
+   it is ready.  Interrupts must be off. */
+static void
+set_effective_priority (struct thread *t, int p)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (t->status == THREAD_READY)
+    {
+      ready_queue_remove (t);
+      t->priority = p;
+      ready_queue_push (t);
+    }
+  else
+    t->priority = p;
+}
+
+/* Donates PRIORITY to T, which holds a lock that a thread of
+   that priority is waiting for.  Has no effect if T's priority
+   is already at least PRIORITY, or under the multi-level
+   feedback queue scheduler.  Interrupts must be off. */
+void
+thread_donate_priority (struct thread *t, int priority)
+{
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (!thread_mlfqs && t->priority < priority)
+    set_effective_priority (t, priority);
+}
+
+/* Recomputes T's priority as the highest of its base priority
+   and the priorities of the threads waiting for locks that T
+   holds.  Called when T releases a lock or changes its base
+   priority.  Interrupts must be off. */
+void
+thread_update_priority (struct thread *t)
+{
+  struct list_elem *le, *we;
+  int p;
+
+  ASSERT (is_thread (t));
+  ASSERT (intr_get_level () == INTR_OFF);
+
+  if (thread_mlfqs)
+    return;
+
+  p = t->base_priority;
+  for (le = list_begin (&t->locks_held); le != list_end (&t->locks_held);
+       le = list_next (le))
+    {
+      struct list *waiters = &list_entry (le, struct lock, elem)
+                               ->semaphore.waiters;
+      for (we = list_begin (waiters); we != list_end (waiters);
+           we = list_next (we))
+        {
+          struct thread *w = list_entry (we, struct thread, elem);
+          if (w->priority > p)
+            p = w->priority;
+        }
+    }
+  if (p != t->priority)
+    set_effective_priority (t, p);
 }
 
 /* Returns the current thread's priority. */
@@ -396,35 +606,50 @@ thread_get_priority (void)
   return thread_current ()->priority;
 }
 
-/* Sets the current thread's nice value to NICE. */
+/* Sets the current thread's nice value to NICE and recomputes
+   its priority, yielding if it no longer has the highest. */
 void
-thread_set_nice (int nice UNUSED) 
+thread_set_nice (int nice) 
 {
-  /* Not yet implemented. */
+  struct thread *cur = thread_current ();
+  enum intr_level old_level;
+
+  ASSERT (NICE_MIN <= nice && nice <= NICE_MAX);
+
+  old_level = intr_disable ();
+  cur->nice = nice;
+  if (thread_mlfqs)
+    mlfqs_update_priority (cur);
+  intr_set_level (old_level);
+  thread_check_preemption ();
 }
 
 /* Returns the current thread's nice value. */
 int
 thread_get_nice (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  return thread_current ()->nice;
 }
 
 /* Returns 100 times the system load average. */
 int
 thread_get_load_avg (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int load = FP_ROUND (FP_MULT_MIX (load_avg, 100));
+  intr_set_level (old_level);
+  return load;
 }
 
 /* Returns 100 times the current thread's recent_cpu value. */
 int
 thread_get_recent_cpu (void) 
 {
-  /* Not yet implemented. */
-  return 0;
+  enum intr_level old_level = intr_disable ();
+  int recent_cpu = FP_ROUND (FP_MULT_MIX (thread_current ()->recent_cpu,
+                                          100));
+  intr_set_level (old_level);
+  return recent_cpu;
 }
 
 /* Idle thread.  Executes when no other thread is ready to run.
@@ -449,6 +674,19 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else wants the CPU, so zero free pages ahead of
+         PAL_ZERO requests.  Go one page at a time and stop as
+         soon as another thread becomes ready. */
+      intr_enable ();
+      while (ready_queue_max_priority () < 0 && palloc_zero_free_page ())
+        continue;
+      intr_disable ();
+      if (ready_queue_max_priority () >= 0)
+        continue;
+
+      /* Don't take timer interrupts that have nothing to do. */
+      timer_idle_enter ();
+
       /* Re-enable interrupts and wait for the next one.
 
          The `sti' instruction disables interrupts until the
@@ -512,7 +750,8 @@ init_thread (struct thread *t, const char *name, int priority)
   t->status = THREAD_BLOCKED;
   strlcpy (t->name, name, sizeof t->name);
   t->stack = (uint8_t *) t + PGSIZE;
-  t->priority = priority;
+  t->priority = t->base_priority = priority;
+  list_init (&t->locks_held);
   t->magic = THREAD_MAGIC;
   // initiable thread relative variables
   list_init(&t->childs);
@@ -528,6 +767,19 @@ init_thread (struct thread *t, const char *name, int priority)
   if(t == initial_thread) t->parent = NULL;
   else t->parent = thread_current();
 
+  /* New threads inherit the scheduling state of their creator. */
+  if (t != initial_thread)
+    {
+      t->nice = t->parent->nice;
+      t->recent_cpu = t->parent->recent_cpu;
+    }
+  if (thread_mlfqs)
+    {
+      old_level = intr_disable ();
+      mlfqs_update_priority (t);
+      intr_set_level (old_level);
+    }
+
   old_level = intr_disable ();
   list_push_back (&all_list, &t->allelem);
   intr_set_level (old_level);
@@ -546,18 +798,68 @@ alloc_frame (struct thread *t, size_t size)
   return t->stack;
 }
 
+/* Adds T to the back of the run queue for its priority.
+   Interrupts must be off. */
+static void
+ready_queue_push (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (PRI_MIN <= t->priority && t->priority <= PRI_MAX);
+
+  list_push_back (&ready_queues[t->priority], &t->elem);
+  ready_bitmap[t->priority / 32] |= 1u << (t->priority % 32);
+  ready_thread_cnt++;
+}
+
+/* Removes ready thread T from its run queue.  Interrupts must be
+   off. */
+static void
+ready_queue_remove (struct thread *t)
+{
+  ASSERT (intr_get_level () == INTR_OFF);
+  ASSERT (t->status == THREAD_READY);
+
+  list_remove (&t->elem);
+  if (list_empty (&ready_queues[t->priority]))
+    ready_bitmap[t->priority / 32] &= ~(1u << (t->priority % 32));
+  ready_thread_cnt--;
+}
+
+/* Returns the highest priority of any ready thread, or -1 if no
+   thread is ready. */
+static int
+ready_queue_max_priority (void)
+{
+  int i;
+
+  for (i = sizeof ready_bitmap / sizeof *ready_bitmap - 1; i >= 0; i--)
+    if (ready_bitmap[i] != 0)
+      return i * 32 + 31 - __builtin_clz (ready_bitmap[i]);
+  return -1;
+}
+
 /* Chooses and returns the next thread to be scheduled.  Should
    return a thread from the run queue, unless the run queue is
    empty.  (If the running thread can continue running, then it
    will be in the run queue.)  If the run queue is empty, return
-   idle_thread. */
+   idle_thread.  Threads of the highest ready priority are
+   scheduled round-robin. */
 static struct thread *
 next_thread_to_run (void) 
 {
-  if (list_empty (&ready_list))
+  int priority = ready_queue_max_priority ();
+  struct list *queue;
+  struct thread *t;
+
+  if (priority < 0)
     return idle_thread;
-  else
-    return list_entry (list_pop_front (&ready_list), struct thread, elem);
+
+  queue = &ready_queues[priority];
+  t = list_entry (list_pop_front (queue), struct thread, elem);
+  if (list_empty (queue))
+    ready_bitmap[priority / 32] &= ~(1u << (priority % 32));
+  ready_thread_cnt--;
+  return t;
 }
 
 /* Completes a thread switch by activating the new thread's page
@@ -606,7 +908,7 @@ thread_schedule_tail (struct thread *prev)
       // release the resources
       while(!list_empty(&prev->childs)){
         struct child_thread *act = list_entry (list_pop_front(&prev->childs), struct child_thread, child_thread_elem);
-        free(act);
+        kmem_cache_free(child_thread_cache, act);
       }
 
       palloc_free_page (prev);
@@ -624,9 +926,15 @@ static void
 schedule (void) 
 {
   struct thread *cur = running_thread ();
-  struct thread *next = next_thread_to_run ();
+  struct thread *next;
   struct thread *prev = NULL;
 
+  /* Bring the tick count up to date if the CPU was idle without
+     timer interrupts, since that may wake up sleeping threads. */
+  if (cur == idle_thread)
+    timer_idle_exit ();
+  next = next_thread_to_run ();
+
   ASSERT (intr_get_level () == INTR_OFF);
   ASSERT (cur->status != THREAD_RUNNING);
   ASSERT (is_thread (next));
@@ -689,7 +997,7 @@ int child_thread_wait(int child_tid) {
   // remove child thread from thread list
   if(e == list_end(l)) return -1;
   list_remove(e);
-  free(ct);
+  kmem_cache_free(child_thread_cache, ct);
   
   return status;
 }
@@ -25,6 +25,11 @@ typedef int tid_t;
 #define PRI_DEFAULT 31                  /* Default priority. */
 #define PRI_MAX 63                      /* Highest priority. */
 
+/* Thread nice values. */
+#define NICE_MIN -20                    /* Nicest. */
+#define NICE_DEFAULT 0                  /* Default nice value. */
+#define NICE_MAX 20                     /* Least nice. */
+
 struct child_thread {
   struct list_elem child_thread_elem;
   int exit_status;
@@ -32,9 +37,6 @@ struct child_thread {
 };
 
 
-struct list sleep_list; // sleeping threads
-
-
 /* A kernel thread or user process.
 
    Each thread structure is stored in its own 4 kB page.  The
@@ -98,7 +100,12 @@ struct thread
     enum thread_status status;          /* Thread state. */
     char name[16];                      /* Name (for debugging purposes). */
     uint8_t *stack;                     /* Saved stack pointer. */
-    int priority;                       /* Priority. */
+    int priority;                       /* Priority, including donations. */
+    int base_priority;                  /* Priority before donations. */
+    struct list locks_held;             /* Locks held, for donation. */
+    struct lock *waiting_lock;          /* Lock being waited for, if any. */
+    int nice;                           /* Nice value, for MLFQS. */
+    int recent_cpu;                     /* Recent CPU time, fixed-point. */
     struct list_elem allelem;           /* List element for all threads list. */
 
     /* Shared between thread.c and synch.c. */
@@ -127,6 +134,7 @@ struct thread
     int max_fd; // the file descriptor used by the thread
 
     int64_t wake_time; //For timer_sleep()
+    struct list_elem sleep_elem; // element in a timer wheel slot
   };
 
 
@@ -141,12 +149,14 @@ void thread_start (void);
 
 void thread_tick (void);
 void thread_print_stats (void);
+void thread_add_idle_ticks (int64_t);
 
 typedef void thread_func (void *aux);
 tid_t thread_create (const char *name, int priority, thread_func *, void *);
 
 void thread_block (void);
 void thread_unblock (struct thread *);
+void thread_check_preemption (void);
 
 struct thread *thread_current (void);
 tid_t thread_tid (void);
@@ -161,6 +171,8 @@ void thread_foreach (thread_action_func *, void *);
 
 int thread_get_priority (void);
 void thread_set_priority (int);
+void thread_donate_priority (struct thread *, int priority);
+void thread_update_priority (struct thread *);
 
 int thread_get_nice (void);
 void thread_set_nice (int);
@@ -22,11 +22,32 @@ pagedir_create (void)
   return pd;
 }
 
+/* Number of pages that pagedir_destroy() hands to
+   palloc_free_batch() at a time. */
+#define FREE_BATCH_CNT 64
+
+/* Adds PAGE to BATCH, which holds *CNT pages, flushing BATCH
+   first if it is full. */
+static void
+batch_free_page (void **batch, size_t *cnt, void *page)
+{
+  if (*cnt == FREE_BATCH_CNT)
+    {
+      palloc_free_batch (batch, *cnt);
+      *cnt = 0;
+    }
+  batch[(*cnt)++] = page;
+}
+
 /* Destroys page directory PD, freeing all the pages it
-   references. */
+   references.  Pages are released in batches, so that the page
+   allocator's locks are taken once per batch instead of once
+   per page. */
 void
 pagedir_destroy (uint32_t *pd) 
 {
+  void *batch[FREE_BATCH_CNT];
+  size_t batch_cnt = 0;
   uint32_t *pde;
 
   if (pd == NULL)
@@ -41,10 +62,11 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
-        palloc_free_page (pt);
+            batch_free_page (batch, &batch_cnt, pte_get_page (*pte));
+        batch_free_page (batch, &batch_cnt, pt);
       }
-  palloc_free_page (pd);
+  batch_free_page (batch, &batch_cnt, pd);
+  palloc_free_batch (batch, batch_cnt);
 }
 
 /* Returns the address of the page table entry for virtual
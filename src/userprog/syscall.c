@@ -1,4 +1,5 @@
 #include "userprog/syscall.h"
+#include <stdint.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include <devices/shutdown.h>
@@ -7,9 +8,12 @@
 #include <string.h>
 #include <filesys/file.h>
 #include <devices/input.h>
+#include <devices/timer.h>
 #include <threads/palloc.h>
 #include <threads/malloc.h>
 #include "threads/interrupt.h"
+#include "threads/slab.h"
+#include "threads/synch.h"
 #include "threads/thread.h"
 #include "process.h"
 #include "pagedir.h"
@@ -23,6 +27,18 @@
 // syscall array
 syscall_function syscalls[SYSCALL_NUMBER];
 
+// readv and writev move data through a kernel buffer this big
+#define IOV_CHUNK_PAGES 4
+#define IOV_CHUNK_SIZE (IOV_CHUNK_PAGES * PGSIZE)
+
+static int copy_in_iovecs(struct iovec *, const struct iovec *, int, bool);
+static struct file_node *find_regular_file(int fd);
+static int open_fd(const char *name);
+static void close_fd(int fd);
+
+// object cache for struct file_node
+struct kmem_cache *file_node_cache;
+
 static void syscall_handler (struct intr_frame *);
 
 void exit(int exit_status){
@@ -34,6 +50,10 @@ void
 syscall_init (void)
 {
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  file_node_cache = kmem_cache_create ("file_node", sizeof (struct file_node),
+                                       NULL);
+  if (file_node_cache == NULL)
+    PANIC ("can't create file_node object cache");
   // initialize the syscalls
   for(int i = 0; i < SYSCALL_NUMBER; i++) syscalls[i] = NULL;
   // bind the syscalls to specific index of the array
@@ -50,43 +70,136 @@ syscall_init (void)
   syscalls[SYS_SEEK] = sys_seek;
   syscalls[SYS_TELL] = sys_tell;
   syscalls[SYS_CLOSE] = sys_close;
+  syscalls[SYS_PREAD] = sys_pread;
+  syscalls[SYS_PWRITE] = sys_pwrite;
+  syscalls[SYS_READV] = sys_readv;
+  syscalls[SYS_WRITEV] = sys_writev;
+  syscalls[SYS_COPY_FILE_RANGE] = sys_copy_file_range;
+  syscalls[SYS_RING_ENTER] = sys_ring_enter;
+  syscalls[SYS_FSYNC] = sys_fsync;
+  syscalls[SYS_FDATASYNC] = sys_fdatasync;
+  syscalls[SYS_ADVISE] = sys_advise;
+  syscalls[SYS_FALLOCATE] = sys_fallocate;
+  syscalls[SYS_FTRUNCATE] = sys_ftruncate;
   /*those are syscall pro4 need*/
   syscalls[SYS_CHDIR] = sys_CHDIR;  /* Change the current directory. */
   syscalls[SYS_MKDIR] = sys_MKDIR;  /* Create a directory. */
   syscalls[SYS_READDIR] = sys_READDIR;/* Reads a directory entry. */
   syscalls[SYS_ISDIR] = sys_ISDIR;   /* Tests if a fd represents a directory. */
   syscalls[SYS_INUMBER] = sys_INUMBER; /* Returns the inode number for a fd. */
+  syscalls[SYS_GETDENTS] = sys_GETDENTS; /* Reads many directory entries. */
   /* For cache test */
   syscalls[SYS_CACHE_FLUSH] = sys_CACHE_FLUSH; /* Cache flash to disk, return the number of flash block*/ 
+  /* For benchmarks */
+  syscalls[SYS_GET_TICKS] = sys_GET_TICKS; /* Timer ticks since boot. */
+  syscalls[SYS_LOCK_STAT] = sys_LOCK_STAT; /* Lock profiler statistics. */
+}
+
+/* Reads a byte at user virtual address UADDR.
+   UADDR must be below PHYS_BASE.
+   Returns the byte value if successful, -1 if a segfault
+   occurred.  page_fault() resumes at the label whose address
+   was loaded into EAX. */
+static int
+get_user (const uint8_t *uaddr)
+{
+  int result;
+  asm volatile ("movl $1f, %0; movzbl %1, %0; 1:"
+                : "=&a" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Writes BYTE to user address UDST.
+   UDST must be below PHYS_BASE.
+   Returns true if successful, false if a segfault occurred. */
+static bool
+put_user (uint8_t *udst, uint8_t byte)
+{
+  int error_code;
+  asm volatile ("movl $1f, %0; movb %b2, %1; 1:"
+                : "=&a" (error_code), "=m" (*udst) : "q" (byte));
+  return error_code != -1;
+}
+
+/* Checks that the SIZE bytes starting at user address UADDR are
+   mapped, and writable too if WRITABLE is true.  The MMU does the
+   work: we touch one byte in every page of the range and let
+   page_fault() report a bad page instead of walking the page
+   table ourselves.  Kills the process on a bad range. */
+void
+check_user_range (const void *uaddr, size_t size, bool writable)
+{
+  const uint8_t *start = uaddr;
+  const uint8_t *end = start + size;
+  const uint8_t *p;
+
+  if (size == 0)
+    return;
+  if (start == NULL || end < start || !is_user_vaddr (end - 1))
+    exit(-1);
+
+  for (p = start; p < end; p = (const uint8_t *) pg_round_down (p) + PGSIZE)
+    {
+      int byte = get_user (p);
+      if (byte == -1)
+        exit(-1);
+      if (writable && !put_user ((uint8_t *) p, byte))
+        exit(-1);
+    }
 }
 
-// check whether page p and p+3 has been in kernel virtual memory
-void check_page(void *p) {
-  void *pagedir = pagedir_get_page(thread_current()->pagedir, p);
-  if(pagedir == NULL) exit(-1);
-  pagedir = pagedir_get_page(thread_current()->pagedir, p + 3);
-  if(pagedir == NULL) exit(-1);
+/* Checks that USTR is a null-terminated string lying entirely in
+   mapped user memory.  Kills the process otherwise. */
+void
+check_user_string (const char *ustr)
+{
+  const uint8_t *p = (const uint8_t *) ustr;
+  int byte;
+
+  if (p == NULL)
+    exit(-1);
+  do
+    {
+      if (!is_user_vaddr (p))
+        exit(-1);
+      byte = get_user (p++);
+      if (byte == -1)
+        exit(-1);
+    }
+  while (byte != '\0');
 }
 
-// check whether page p and p+3 is a user virtual address
-void check_addr(void *p) {
-  if(!is_user_vaddr(p)) exit(-1);
-  if(!is_user_vaddr(p + 3)) exit(-1);
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Kills the process if any byte of USRC is bad. */
+void
+copy_in (void *dst, const void *usrc, size_t size)
+{
+  uint8_t *d = dst;
+  const uint8_t *s = usrc;
+
+  check_user_range (usrc, size, false);
+  for (; size > 0; size--)
+    *d++ = get_user (s++);
 }
 
-// make check for page p
-void check(void *p) {
-  if(p == NULL) exit(-1);
-  check_addr(p);
-  check_page(p);
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Kills the process if any byte of UDST is bad. */
+void
+copy_out (void *udst, const void *src, size_t size)
+{
+  uint8_t *d = udst;
+  const uint8_t *s = src;
+
+  if (size > 0 && (d == NULL || !is_user_vaddr (d + size - 1)))
+    exit(-1);
+  for (; size > 0; size--)
+    if (!put_user (d++, *s++))
+      exit(-1);
 }
 
-// make check for every function arguments
+// make check for ARGC 4-byte function arguments starting at P
 void check_func_args(void *p, int argc) {
-  for(int i = 0; i < argc; i++) {
-    check(p);
-    p++;
-  }
+  check_user_range (p, argc * sizeof (int), false);
 }
 
 // search the file list of the thread_current()
@@ -105,9 +218,8 @@ struct file_node * find_file(struct list *files, int fd){
 static void
 syscall_handler (struct intr_frame *f)
 {
-  check((void *)f->esp);
-  check((void *)(f->esp + 4));
-  int num=*((int *)(f->esp));
+  int num;
+  copy_in (&num, f->esp, sizeof num);
   // check whether the function is implemented
   if(num < 0 || num >= SYSCALL_NUMBER) exit(-1);
   if(syscalls[num] == NULL) exit(-1);
@@ -116,6 +228,7 @@ syscall_handler (struct intr_frame *f)
 
 void sys_exit(struct intr_frame * f) {
   int *p = f->esp;
+  check_func_args((void *)(p + 1), 1);
   // save exit status
   exit(*(p + 1));
 }
@@ -126,21 +239,21 @@ void sys_halt(struct intr_frame * f UNUSED) {
 
 void sys_exec(struct intr_frame * f) {
   int * p =f->esp;
-  check((void *)(p + 1));
-  check((void *)(*(p + 1)));
+  check_func_args((void *)(p + 1), 1);
+  check_user_string((const char *)*(p + 1));
   f->eax = process_execute((char*)*(p + 1));
 }
 
 void sys_wait(struct intr_frame * f) {
   int * p =f->esp;
-  check(p + 1);
+  check_func_args((void *)(p + 1), 1);
   f->eax = process_wait(*(p + 1));
 }
 
 void sys_create(struct intr_frame * f) {
   int * p =f->esp;
   check_func_args((void *)(p + 1), 2);
-  check((void *)*(p + 1));
+  check_user_string((const char *)*(p + 1));
 
   acquire_file_lock();
   // thread_exit ();
@@ -155,7 +268,7 @@ void sys_remove(struct intr_frame * f) {
   int * p =f->esp;
   
   check_func_args((void *)(p + 1), 1);
-  check((void*)*(p + 1));
+  check_user_string((const char *)*(p + 1));
 
   acquire_file_lock();
   f->eax = filesys_remove((const char *)*(p + 1));
@@ -165,23 +278,26 @@ void sys_remove(struct intr_frame * f) {
 void sys_open(struct intr_frame * f) {
   int * p =f->esp;
   check_func_args((void *)(p + 1), 1);
-  check((void*)*(p + 1));
+  check_user_string((const char *)*(p + 1));
+  f->eax = open_fd((const char *)*(p + 1));
+}
 
+// open the file NAME, already checked, and return its new fd, or -1
+static int open_fd(const char *name) {
   struct thread * t = thread_current();
   acquire_file_lock();
-  struct file * open_f = filesys_open((const char *)*(p + 1));
+  struct file * open_f = filesys_open(name);
   release_file_lock();
   // check whether the open file is valid
   if(open_f){
-    struct file_node *fn = malloc(sizeof(struct file_node));
+    struct file_node *fn = kmem_cache_alloc(file_node_cache);
     fn->fd = t->max_fd++;
     fn->file = open_f;
-    fn->read_dir_cnt = 0;
     // put in file list of the corresponding thread
     list_push_back(&t->files, &fn->file_elem);
-    f->eax = fn->fd;
+    return fn->fd;
   } else
-    f->eax = -1;
+    return -1;
 }
 
 void sys_filesize(struct intr_frame * f) {
@@ -200,11 +316,12 @@ void sys_filesize(struct intr_frame * f) {
 void sys_read(struct intr_frame * f) {
   int * p =f->esp;
   check_func_args((void *)(p + 1), 3);
-  check((void *)*(p + 2));
 
   int fd = *(p + 1);
   uint8_t * buffer = (uint8_t*)*(p + 2);
-  off_t size = *(p + 3);  
+  off_t size = *(p + 3);
+  // the whole buffer is written, so all of it must be writable
+  check_user_range(buffer, size, true);
   // read from standard input
   if (fd == 0) {
     for (int i=0; i<size; i++)
@@ -230,10 +347,10 @@ void sys_read(struct intr_frame * f) {
 void sys_write(struct intr_frame * f) {
   int * p =f->esp;
   check_func_args((void *)(p + 1), 3);
-  check((void *)*(p + 2));
   int fd2 = *(p + 1);
   const char * buffer2 = (const char *)*(p + 2);
   off_t size2 = *(p + 3);
+  check_user_range(buffer2, size2, false);
   // write to standard output
   if (fd2==1) {
     putbuf(buffer2,size2);
@@ -283,17 +400,239 @@ void sys_tell(struct intr_frame * f) {
 void sys_close(struct intr_frame * f) {
   int *p = f->esp;
   check_func_args((void *)(p + 1), 1);
-  struct file_node * openf = find_file(&thread_current()->files, *(p + 1));
+  close_fd(*(p + 1));
+}
+
+// close FD if the current thread has it open
+static void close_fd(int fd) {
+  struct file_node * openf = find_file(&thread_current()->files, fd);
   if (openf){
     acquire_file_lock();
     file_close(openf->file);
     release_file_lock();
     // remove file form file list
     list_remove(&openf->file_elem);
-    free(openf);
+    kmem_cache_free(file_node_cache, openf);
   }
 }
 
+/* Returns the open regular file FD of the current thread, or a
+   null pointer if there is none. */
+static struct file_node *find_regular_file(int fd) {
+  struct file_node *openf = find_file(&thread_current()->files, fd);
+  if (openf == NULL || !is_really_file(openf->file))
+    return NULL;
+  return openf;
+}
+
+void sys_pread(struct intr_frame * f) {
+  /* Reads at an offset, leaving the file position alone.  The
+     file lock is not needed: inode_read_at() looks up and copies
+     each sector under the inode's extend_lock, which a truncate
+     holds while it frees sectors. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 4);
+  uint8_t *buffer = (uint8_t *)*(p + 2);
+  off_t size = *(p + 3);
+  off_t ofs = *(p + 4);
+  check_user_range(buffer, size, true);
+
+  struct file_node *openf = find_regular_file(*(p + 1));
+  if (openf == NULL || size < 0 || ofs < 0){
+    f->eax = -1;
+    return;
+  }
+  f->eax = file_read_at(openf->file, buffer, size, ofs);
+}
+
+void sys_pwrite(struct intr_frame * f) {
+  /* Writes at an offset, leaving the file position alone. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 4);
+  const uint8_t *buffer = (const uint8_t *)*(p + 2);
+  off_t size = *(p + 3);
+  off_t ofs = *(p + 4);
+  check_user_range(buffer, size, false);
+
+  struct file_node *openf = find_regular_file(*(p + 1));
+  if (openf == NULL || size < 0 || ofs < 0){
+    f->eax = -1;
+    return;
+  }
+  acquire_file_lock();
+  f->eax = file_write_at(openf->file, buffer, size, ofs);
+  release_file_lock();
+}
+
+/* Copies the CNT-entry iovec array UIOV from user memory into
+   IOV and checks that each buffer is user memory, writable if
+   WRITABLE.  Returns the total length of the buffers, or -1 if
+   CNT or the total is out of range. */
+static int copy_in_iovecs(struct iovec *iov, const struct iovec *uiov,
+                          int cnt, bool writable) {
+  size_t total = 0;
+  int i;
+
+  if (cnt < 0 || cnt > IOV_MAX)
+    return -1;
+  copy_in(iov, uiov, cnt * sizeof *iov);
+  for (i = 0; i < cnt; i++){
+    check_user_range(iov[i].iov_base, iov[i].iov_len, writable);
+    total += iov[i].iov_len;
+    if (iov[i].iov_len > INT32_MAX || total > INT32_MAX)
+      return -1;
+  }
+  return total;
+}
+
+void sys_readv(struct intr_frame * f) {
+  /* Reads into many buffers, from the file position on, through
+     one kernel buffer, so that a whole request of up to
+     IOV_CHUNK_SIZE bytes takes a single inode_read_at pass. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 3);
+  struct iovec iov[IOV_MAX];
+  int cnt = *(p + 3);
+  int total = copy_in_iovecs(iov, (const struct iovec *)*(p + 2), cnt, true);
+  struct file_node *openf = find_regular_file(*(p + 1));
+  if (openf == NULL || total < 0){
+    f->eax = -1;
+    return;
+  }
+
+  uint8_t *chunk = palloc_get_multiple(0, IOV_CHUNK_PAGES);
+  if (chunk == NULL){
+    f->eax = -1;
+    return;
+  }
+  int done = 0, i = 0;
+  size_t iov_ofs = 0;
+  acquire_file_lock();
+  while (done < total){
+    off_t want = total - done < IOV_CHUNK_SIZE ? total - done : IOV_CHUNK_SIZE;
+    off_t got = file_read(openf->file, chunk, want);
+    off_t ofs = 0;
+
+    // scatter what was read over the user buffers
+    while (ofs < got){
+      size_t n = iov[i].iov_len - iov_ofs;
+      if (n > (size_t) (got - ofs))
+        n = got - ofs;
+      memcpy((uint8_t *) iov[i].iov_base + iov_ofs, chunk + ofs, n);
+      ofs += n;
+      iov_ofs += n;
+      if (iov_ofs == iov[i].iov_len){
+        i++;
+        iov_ofs = 0;
+      }
+    }
+    done += got;
+    if (got < want)
+      break;
+  }
+  release_file_lock();
+  palloc_free_multiple(chunk, IOV_CHUNK_PAGES);
+  f->eax = done;
+}
+
+void sys_writev(struct intr_frame * f) {
+  /* Writes from many buffers at the file position, gathering them
+     into one kernel buffer, so that a whole request of up to
+     IOV_CHUNK_SIZE bytes takes a single inode_write_at pass. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 3);
+  struct iovec iov[IOV_MAX];
+  int fd = *(p + 1);
+  int cnt = *(p + 3);
+  int total = copy_in_iovecs(iov, (const struct iovec *)*(p + 2), cnt, false);
+  int i;
+  if (total < 0){
+    f->eax = -1;
+    return;
+  }
+  // write to standard output
+  if (fd == 1){
+    for (i = 0; i < cnt; i++)
+      putbuf(iov[i].iov_base, iov[i].iov_len);
+    f->eax = total;
+    return;
+  }
+  struct file_node *openf = find_regular_file(fd);
+  if (openf == NULL){
+    f->eax = -1;
+    return;
+  }
+
+  uint8_t *chunk = palloc_get_multiple(0, IOV_CHUNK_PAGES);
+  if (chunk == NULL){
+    f->eax = -1;
+    return;
+  }
+  int done = 0;
+  size_t iov_ofs = 0;
+  i = 0;
+  acquire_file_lock();
+  while (done < total){
+    off_t fill = 0;
+
+    // gather the user buffers into the chunk
+    while (fill < IOV_CHUNK_SIZE && i < cnt){
+      size_t n = iov[i].iov_len - iov_ofs;
+      if (n > (size_t) (IOV_CHUNK_SIZE - fill))
+        n = IOV_CHUNK_SIZE - fill;
+      memcpy(chunk + fill, (uint8_t *) iov[i].iov_base + iov_ofs, n);
+      fill += n;
+      iov_ofs += n;
+      if (iov_ofs == iov[i].iov_len){
+        i++;
+        iov_ofs = 0;
+      }
+    }
+    off_t written = file_write(openf->file, chunk, fill);
+    done += written;
+    if (written < fill)
+      break;
+  }
+  release_file_lock();
+  palloc_free_multiple(chunk, IOV_CHUNK_PAGES);
+  f->eax = done;
+}
+
+void sys_copy_file_range(struct intr_frame * f) {
+  /* Copies between two open files without a user buffer.  A
+     negative offset means the file position, which is then
+     advanced past the bytes copied. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 5);
+  struct file_node *in = find_regular_file(*(p + 1));
+  struct file_node *out = find_regular_file(*(p + 3));
+  off_t size = *(p + 5);
+  if (in == NULL || out == NULL || size < 0){
+    f->eax = -1;
+    return;
+  }
+
+  acquire_file_lock();
+  off_t in_ofs = *(p + 2) < 0 ? file_tell(in->file) : *(p + 2);
+  off_t out_ofs = *(p + 4) < 0 ? file_tell(out->file) : *(p + 4);
+
+  // the copy runs forward one sector at a time, so an overlapping
+  // range within one file would read back its own output
+  if (file_get_inode(in->file) == file_get_inode(out->file)
+      && in_ofs < out_ofs + size && out_ofs < in_ofs + size){
+    release_file_lock();
+    f->eax = -1;
+    return;
+  }
+  off_t copied = file_copy_range(in->file, in_ofs, out->file, out_ofs, size);
+  if (*(p + 2) < 0)
+    file_seek(in->file, in_ofs + copied);
+  if (*(p + 4) < 0)
+    file_seek(out->file, out_ofs + copied);
+  release_file_lock();
+  f->eax = copied;
+}
+
 
 
 /* Project 4 only. */
@@ -302,14 +641,16 @@ void sys_CHDIR(struct intr_frame *f){
   int * p =f->esp;
   check_func_args((void *)(p + 1), 1);
   const char * udir = (const char *)*(p + 1);
+  check_user_string(udir);
   f->eax = filesys_chdir(udir);
 }
 void sys_MKDIR(struct intr_frame *f){
   /* Create a directory. */
 
   int * p =f->esp;
-  // somthing to check address
+  check_func_args((void *)(p + 1), 1);
   const char * file_name = (const char *)*(p + 1);
+  check_user_string(file_name);
   if(strcmp(file_name, "")==0){
     f->eax = 0;
   }
@@ -319,25 +660,59 @@ void sys_MKDIR(struct intr_frame *f){
 void sys_READDIR(struct intr_frame *f){
   /* Reads a directory entry. */
   int *p = f->esp;
+  check_func_args((void *)(p + 1), 2);
   int fd = *(p + 1);
-  const char * dir_name = (const char *)*(p + 2);
+  char * uname = (char *)*(p + 2);
+  char name[READDIR_MAX_LEN + 1];
 
   struct file_node * openf = find_file(&thread_current()->files, fd);
-  bool ok;
+  bool ok = false;
   if(openf!=NULL){
-    openf->read_dir_cnt ++;
-    ok = read_dir_by_file_node(openf->file, dir_name, openf->read_dir_cnt);
+    ok = read_dir_by_file_node(openf->file, name, NULL);
   }
   f->eax = ok;
-  // if (ok)
-  //   copy_out (uname, name, strlen (name) + 1);
-  // return ok;
+  if (ok)
+    copy_out (uname, name, strlen (name) + 1);
+}
+
+void sys_GETDENTS(struct intr_frame *f){
+  /* Reads up to COUNT entries of a directory into a user buffer,
+     continuing where the last readdir or getdents on the fd left
+     off.  Returns the number of entries read, 0 at the end of the
+     directory, or -1 if the fd is not an open directory. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 3);
+  int fd = *(p + 1);
+  struct dirent *uentries = (struct dirent *)*(p + 2);
+  int count = *(p + 3);
 
+  struct file_node * openf = find_file(&thread_current()->files, fd);
+  if (openf == NULL || is_really_file(openf->file)
+      || count < 0 || (size_t) count > SIZE_MAX / sizeof *uentries){
+    f->eax = -1;
+    return;
+  }
+  check_user_range(uentries, count * sizeof *uentries, true);
+
+  int n = 0;
+  struct dirent d;
+  block_sector_t sector;
+  memset(&d, 0, sizeof d);
+  while (n < count && read_dir_by_file_node(openf->file, d.name, &sector)){
+    struct inode *inode = inode_open(sector);
+    d.inumber = sector;
+    d.is_dir = inode != NULL && inode->data.is_file == DIR_TYPE;
+    inode_close(inode);
+    copy_out(uentries + n, &d, sizeof d);
+    n++;
+  }
+  f->eax = n;
 }
 
 void sys_ISDIR(struct intr_frame *f){
   /* Tests if a fd represents a directory. */
   int * p =f->esp;
+  check_func_args((void *)(p + 1), 1);
   int fd = *(p + 1);
   struct file_node * openf = find_file(&thread_current()->files, fd);
   // check whether the write file is valid
@@ -352,6 +727,7 @@ void sys_ISDIR(struct intr_frame *f){
 void sys_INUMBER(struct intr_frame *f){
   /* Returns the inode number for a fd. */
   int * p =f->esp;
+  check_func_args((void *)(p + 1), 1);
   int fd = *(p + 1);
   struct file_node * openf = find_file(&thread_current()->files, fd);
   // check whether the write file is valid
@@ -363,3 +739,170 @@ void sys_INUMBER(struct intr_frame *f){
 void sys_CACHE_FLUSH(struct intr_frame *f) {
   f->eax = test_cache_flash();
 }
+
+void sys_GET_TICKS(struct intr_frame *f) {
+  f->eax = timer_ticks();
+}
+
+void sys_LOCK_STAT(struct intr_frame *f) {
+  /* Copies out the statistics of a profiled lock. */
+  int * p =f->esp;
+  check_func_args((void *)(p + 1), 2);
+  int index = *(p + 1);
+  void *ustat = (void *) *(p + 2);
+  struct lock_stat stat;
+  f->eax = lock_get_stat(index, &stat);
+  if (f->eax)
+    copy_out(ustat, &stat, sizeof stat);
+}
+
+/* Runs the queued operation SQE as its system call would and
+   returns that call's result. */
+static int ring_run(const struct ring_sqe *sqe) {
+  struct file_node *openf;
+  int result;
+
+  switch (sqe->op){
+    case RING_OP_NOP:
+      return 0;
+    case RING_OP_OPEN:
+      check_user_string(sqe->buf);
+      return open_fd(sqe->buf);
+    case RING_OP_CLOSE:
+      close_fd(sqe->fd);
+      return 0;
+    case RING_OP_READ:
+      check_user_range(sqe->buf, sqe->len, true);
+      openf = find_regular_file(sqe->fd);
+      if (openf == NULL || (off_t) sqe->len < 0)
+        return -1;
+      acquire_file_lock();
+      if (sqe->offset < 0)
+        result = file_read(openf->file, sqe->buf, sqe->len);
+      else
+        result = file_read_at(openf->file, sqe->buf, sqe->len, sqe->offset);
+      release_file_lock();
+      return result;
+    case RING_OP_WRITE:
+      check_user_range(sqe->buf, sqe->len, false);
+      if (sqe->fd == 1){
+        putbuf(sqe->buf, sqe->len);
+        return sqe->len;
+      }
+      openf = find_regular_file(sqe->fd);
+      if (openf == NULL || (off_t) sqe->len < 0)
+        return -1;
+      acquire_file_lock();
+      if (sqe->offset < 0)
+        result = file_write(openf->file, sqe->buf, sqe->len);
+      else
+        result = file_write_at(openf->file, sqe->buf, sqe->len, sqe->offset);
+      release_file_lock();
+      return result;
+    default:
+      return -1;
+  }
+}
+
+void sys_ring_enter(struct intr_frame * f) {
+  /* Runs up to TO_SUBMIT operations queued on the ring, in order,
+     posting a completion for each.  The ring is checked once per
+     call, not once per operation.  Stops early when the completion
+     queue is full; returns the number of operations run. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 2);
+  struct ring *ring = (struct ring *)*(p + 1);
+  unsigned to_submit = *(p + 2);
+  unsigned done = 0;
+  check_user_range(ring, sizeof *ring, true);
+
+  while (done < to_submit && ring->sq_head != ring->sq_tail
+         && ring->cq_tail - ring->cq_head < RING_ENTRIES){
+    // copy the entry so the process cannot change it under us
+    struct ring_sqe sqe = ring->sq[ring->sq_head % RING_ENTRIES];
+    struct ring_cqe *cqe = &ring->cq[ring->cq_tail % RING_ENTRIES];
+    int result = ring_run(&sqe);
+    cqe->user_data = sqe.user_data;
+    cqe->result = result;
+    ring->sq_head++;
+    ring->cq_tail++;
+    done++;
+  }
+  f->eax = done;
+}
+
+/* Writes the data of open file FD, and its inode too unless
+   DATA_ONLY, to disk.  Returns 0, or -1 if FD is not open. */
+static int sync_fd(int fd, bool data_only) {
+  struct file_node *openf = find_file(&thread_current()->files, fd);
+  if (openf == NULL)
+    return -1;
+  acquire_file_lock();
+  file_sync(openf->file, data_only);
+  release_file_lock();
+  return 0;
+}
+
+void sys_fsync(struct intr_frame * f) {
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 1);
+  f->eax = sync_fd(*(p + 1), false);
+}
+
+void sys_fdatasync(struct intr_frame * f) {
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 1);
+  f->eax = sync_fd(*(p + 1), true);
+}
+
+void sys_advise(struct intr_frame * f) {
+  /* Passes an access hint for a range of a file to the buffer
+     cache.  Returns 0, or -1 for a bad fd, range or hint. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 4);
+  struct file_node *openf = find_regular_file(*(p + 1));
+  off_t offset = *(p + 2);
+  off_t len = *(p + 3);
+  int advice = *(p + 4);
+  if (openf == NULL || offset < 0 || len < 0
+      || advice < ADVICE_NORMAL || advice > ADVICE_DONTNEED){
+    f->eax = -1;
+    return;
+  }
+  acquire_file_lock();
+  file_advise(openf->file, offset, len, advice);
+  release_file_lock();
+  f->eax = 0;
+}
+
+void sys_fallocate(struct intr_frame * f) {
+  /* Reserves disk space for a range of a file, growing it if the
+     range ends past its end.  Returns 0, or -1 on failure. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 3);
+  struct file_node *openf = find_regular_file(*(p + 1));
+  off_t offset = *(p + 2);
+  off_t len = *(p + 3);
+  if (openf == NULL || offset < 0 || len < 0 || offset + len < offset){
+    f->eax = -1;
+    return;
+  }
+  acquire_file_lock();
+  f->eax = file_allocate(openf->file, offset, len) ? 0 : -1;
+  release_file_lock();
+}
+
+void sys_ftruncate(struct intr_frame * f) {
+  /* Sets the length of a file.  Returns 0, or -1 on failure. */
+  int *p = f->esp;
+  check_func_args((void *)(p + 1), 2);
+  struct file_node *openf = find_regular_file(*(p + 1));
+  off_t length = *(p + 2);
+  if (openf == NULL || length < 0){
+    f->eax = -1;
+    return;
+  }
+  acquire_file_lock();
+  f->eax = file_truncate(openf->file, length) ? 0 : -1;
+  release_file_lock();
+}
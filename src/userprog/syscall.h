@@ -1,18 +1,24 @@
 #ifndef USERPROG_SYSCALL_H
 #define USERPROG_SYSCALL_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include "threads/interrupt.h"
 #include "list.h"
 
 typedef void (*syscall_function) (struct intr_frame *);
-#define SYSCALL_NUMBER 25
+#define SYSCALL_NUMBER 36
 
 void syscall_init (void);
 
-void check(void *);
+// object cache for struct file_node
+extern struct kmem_cache *file_node_cache;
+
 void check_func_args(void *, int);
-void check_page(void *);
-void check_addr(void *p);
+void check_user_range(const void *, size_t, bool);
+void check_user_string(const char *);
+void copy_in(void *, const void *, size_t);
+void copy_out(void *, const void *, size_t);
 
 // declarations of syscalls
 void sys_exit(struct intr_frame *);
@@ -28,6 +34,17 @@ void sys_write(struct intr_frame *);
 void sys_seek(struct intr_frame *);
 void sys_tell(struct intr_frame *);
 void sys_close(struct intr_frame *);
+void sys_pread(struct intr_frame *);
+void sys_pwrite(struct intr_frame *);
+void sys_readv(struct intr_frame *);
+void sys_writev(struct intr_frame *);
+void sys_copy_file_range(struct intr_frame *);
+void sys_ring_enter(struct intr_frame *);
+void sys_fsync(struct intr_frame *);
+void sys_fdatasync(struct intr_frame *);
+void sys_advise(struct intr_frame *);
+void sys_fallocate(struct intr_frame *);
+void sys_ftruncate(struct intr_frame *);
 
 /* Project 4 only. */
 void sys_CHDIR(struct intr_frame *);  /* Change the current directory. */
@@ -35,8 +52,11 @@ void sys_MKDIR(struct intr_frame *);  /* Create a directory. */
 void sys_READDIR(struct intr_frame *);/* Reads a directory entry. */
 void sys_ISDIR(struct intr_frame *);   /* Tests if a fd represents a directory. */
 void sys_INUMBER(struct intr_frame *); /* Returns the inode number for a fd. */
+void sys_GETDENTS(struct intr_frame *); /* Reads many directory entries. */
 
 void sys_CACHE_FLUSH(struct intr_frame *); /* */
+void sys_GET_TICKS(struct intr_frame *);   /* Timer ticks since boot. */
+void sys_LOCK_STAT(struct intr_frame *);   /* Lock profiler statistics. */
 
 struct file_node * find_file(struct list *, int);
 void exit(int);
@@ -46,6 +66,5 @@ struct file_node {
     int fd;
     struct file *file;
     struct list_elem file_elem;
-    int read_dir_cnt;
 };
 #endif /* userprog/syscall.h */
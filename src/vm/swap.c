@@ -0,0 +1,476 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include <list.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/block.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Swap space.
+
+   Every page written to the swap device costs SECTORS_PER_PAGE
+   sector writes now and as many reads later.  To cut that I/O,
+   swap_out() looks at the page first:
+
+     - A page of all zeros takes no storage at all.
+
+     - If compression is enabled, a page that compresses to at
+       most SWAP_MAX_COMPRESSED bytes is kept, compressed, in a
+       RAM pool of at most SWAP_POOL_LIMIT bytes.  When the pool
+       is full, its oldest pages are spilled to the swap device.
+
+     - Anything else goes to a page-sized slot on the swap
+       device, as usual. */
+
+/* Sectors in one page. */
+#define SECTORS_PER_PAGE (PGSIZE / BLOCK_SECTOR_SIZE)
+
+/* Most bytes a compressed page may take: the largest block size
+   malloc() carves out of a shared arena page (see malloc_init()).
+   Anything bigger would take a whole page of its own, saving no
+   RAM at all, and make the pool's real size much larger than
+   the compressed bytes it counts against SWAP_POOL_LIMIT. */
+#define SWAP_MAX_COMPRESSED (PGSIZE / 4)
+
+/* Most bytes of compressed data kept in RAM. */
+#define SWAP_POOL_LIMIT (64 * PGSIZE)
+
+/* Where a swapped-out page lives. */
+enum swap_location
+  {
+    SWAP_ZERO,                  /* All zeros, nothing stored. */
+    SWAP_RAM,                   /* Compressed in the RAM pool. */
+    SWAP_DISK                   /* In a slot on the swap device. */
+  };
+
+struct swap_slot
+  {
+    enum swap_location where;   /* Where the page lives. */
+    uint8_t *data;              /* SWAP_RAM: compressed bytes. */
+    size_t size;                /* SWAP_RAM: bytes in DATA. */
+    size_t disk_slot;           /* SWAP_DISK: page slot on device. */
+    struct list_elem pool_elem; /* SWAP_RAM: element in pool_list. */
+  };
+
+bool swap_compress;
+
+static struct block *swap_device;   /* Swap device, may be null. */
+static struct bitmap *swap_map;     /* Used page slots on device. */
+static struct lock swap_lock;       /* Protects everything here. */
+
+/* Compressed pages, oldest first, and their total size. */
+static struct list pool_list;
+static size_t pool_bytes;
+
+/* Scratch buffers, protected by swap_lock. */
+static uint8_t compress_buf[PGSIZE];
+static uint8_t spill_buf[PGSIZE];
+
+/* Statistics. */
+static long long pages_out;         /* Calls to swap_out(). */
+static long long zero_pages;        /* ...that were all zeros. */
+static long long ram_pages;         /* ...that went to the pool. */
+static long long raw_bytes;         /* Bytes compressed into pool. */
+static long long packed_bytes;      /* Bytes they compressed to. */
+static long long spilled_pages;     /* Pool pages moved to disk. */
+static long long sectors_written;   /* Sectors written to device. */
+static long long sectors_read;      /* Sectors read from device. */
+
+static size_t lz_compress (const uint8_t *, size_t, uint8_t *, size_t);
+static size_t lz_decompress (const uint8_t *, size_t, uint8_t *, size_t);
+
+/* Initializes the swap space.  Runs without a swap device, in
+   which case only zero pages and the RAM pool are available. */
+void
+swap_init (void)
+{
+  lock_init (&swap_lock);
+  list_init (&pool_list);
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    {
+      swap_map = bitmap_create (block_size (swap_device) / SECTORS_PER_PAGE);
+      if (swap_map == NULL)
+        PANIC ("bitmap creation failed--swap device is too large");
+    }
+}
+
+/* Returns true if the page at KPAGE is all zeros. */
+static bool
+is_zero_page (const void *kpage)
+{
+  const uint32_t *p = kpage;
+  size_t i;
+
+  for (i = 0; i < PGSIZE / sizeof *p; i++)
+    if (p[i] != 0)
+      return false;
+  return true;
+}
+
+/* Writes the page at KPAGE to a free slot on the swap device
+   and records the slot in S.  Returns false if there is no swap
+   device or it is full. */
+static bool
+write_to_disk (struct swap_slot *s, const void *kpage)
+{
+  size_t slot, i;
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+
+  if (swap_device == NULL)
+    return false;
+  slot = bitmap_scan_and_flip (swap_map, 0, 1, false);
+  if (slot == BITMAP_ERROR)
+    return false;
+
+  for (i = 0; i < SECTORS_PER_PAGE; i++)
+    block_write (swap_device, slot * SECTORS_PER_PAGE + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  sectors_written += SECTORS_PER_PAGE;
+
+  s->where = SWAP_DISK;
+  s->disk_slot = slot;
+  return true;
+}
+
+/* Moves the oldest page in the RAM pool to the swap device.
+   Returns false if the pool is empty or the device is full. */
+static bool
+spill_oldest (void)
+{
+  struct swap_slot *s;
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+
+  if (list_empty (&pool_list))
+    return false;
+  s = list_entry (list_front (&pool_list), struct swap_slot, pool_elem);
+  if (lz_decompress (s->data, s->size, spill_buf, PGSIZE) != PGSIZE)
+    PANIC ("corrupt compressed swap page");
+  if (!write_to_disk (s, spill_buf))
+    return false;
+
+  list_remove (&s->pool_elem);
+  pool_bytes -= s->size;
+  free (s->data);
+  s->data = NULL;
+  spilled_pages++;
+  return true;
+}
+
+/* Tries to keep the page at KPAGE compressed in the RAM pool,
+   making room by spilling older pages if necessary.  Returns
+   true if successful, false if the page must go to disk. */
+static bool
+store_compressed (struct swap_slot *s, const void *kpage)
+{
+  size_t size;
+
+  ASSERT (lock_held_by_current_thread (&swap_lock));
+
+  size = lz_compress (kpage, PGSIZE, compress_buf, SWAP_MAX_COMPRESSED);
+  if (size == 0)
+    return false;
+  while (pool_bytes + size > SWAP_POOL_LIMIT)
+    if (!spill_oldest ())
+      return false;
+
+  s->data = malloc (size);
+  if (s->data == NULL)
+    return false;
+  memcpy (s->data, compress_buf, size);
+  s->size = size;
+  s->where = SWAP_RAM;
+  list_push_back (&pool_list, &s->pool_elem);
+  pool_bytes += size;
+
+  ram_pages++;
+  raw_bytes += PGSIZE;
+  packed_bytes += size;
+  return true;
+}
+
+/* Saves the page at KPAGE to swap and returns the slot holding
+   it, or a null pointer if swap is full. */
+struct swap_slot *
+swap_out (const void *kpage)
+{
+  struct swap_slot *s;
+
+  ASSERT (pg_ofs (kpage) == 0);
+
+  s = malloc (sizeof *s);
+  if (s == NULL)
+    return NULL;
+  s->data = NULL;
+
+  lock_acquire (&swap_lock);
+  pages_out++;
+  if (is_zero_page (kpage))
+    {
+      s->where = SWAP_ZERO;
+      zero_pages++;
+    }
+  else if (!(swap_compress && store_compressed (s, kpage))
+           && !write_to_disk (s, kpage))
+    {
+      free (s);
+      s = NULL;
+    }
+  lock_release (&swap_lock);
+
+  return s;
+}
+
+/* Reads the page held in slot S into KPAGE and frees S. */
+void
+swap_in (struct swap_slot *s, void *kpage)
+{
+  size_t i;
+
+  ASSERT (s != NULL);
+  ASSERT (pg_ofs (kpage) == 0);
+
+  lock_acquire (&swap_lock);
+  switch (s->where)
+    {
+    case SWAP_ZERO:
+      memset (kpage, 0, PGSIZE);
+      break;
+
+    case SWAP_RAM:
+      if (lz_decompress (s->data, s->size, kpage, PGSIZE) != PGSIZE)
+        PANIC ("corrupt compressed swap page");
+      break;
+
+    case SWAP_DISK:
+      for (i = 0; i < SECTORS_PER_PAGE; i++)
+        block_read (swap_device, s->disk_slot * SECTORS_PER_PAGE + i,
+                    (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+      sectors_read += SECTORS_PER_PAGE;
+      break;
+    }
+  lock_release (&swap_lock);
+
+  swap_free (s);
+}
+
+/* Discards the page held in slot S, which may be null. */
+void
+swap_free (struct swap_slot *s)
+{
+  if (s == NULL)
+    return;
+
+  lock_acquire (&swap_lock);
+  if (s->where == SWAP_RAM)
+    {
+      list_remove (&s->pool_elem);
+      pool_bytes -= s->size;
+      free (s->data);
+    }
+  else if (s->where == SWAP_DISK)
+    bitmap_reset (swap_map, s->disk_slot);
+  lock_release (&swap_lock);
+
+  free (s);
+}
+
+/* Prints swap statistics. */
+void
+swap_print_stats (void)
+{
+  long long sectors_total = pages_out * SECTORS_PER_PAGE;
+
+  printf ("Swap: %lld pages out (%lld zero, %lld compressed, "
+          "%lld spilled), %lld sectors written, %lld read\n",
+          pages_out, zero_pages, ram_pages, spilled_pages,
+          sectors_written, sectors_read);
+  if (packed_bytes > 0)
+    printf ("Swap: compression ratio %lld.%02lld, "
+            "%lld of %lld sector writes saved\n",
+            raw_bytes / packed_bytes, raw_bytes * 100 / packed_bytes % 100,
+            sectors_total - sectors_written, sectors_total);
+}
+
+/* A small LZ77 codec in the style of LZ4.
+
+   The compressed stream is a series of sequences.  Each starts
+   with a token byte whose high nibble is a literal count and
+   whose low nibble is a match length minus LZ_MIN_MATCH; a
+   nibble of 15 is continued by extra bytes that are added to
+   it, up to and including the first byte less than 255.  The
+   literals follow, then a 2-byte little-endian back-reference
+   offset.  The last sequence has only literals. */
+
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+
+/* Most recent position + 1 of each hashed 4-byte string,
+   protected by swap_lock. */
+static uint16_t lz_table[1 << LZ_HASH_BITS];
+
+static inline uint32_t
+lz_read32 (const uint8_t *p)
+{
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static inline unsigned
+lz_hash (uint32_t x)
+{
+  return (x * 2654435761u) >> (32 - LZ_HASH_BITS);
+}
+
+/* Appends a length extension for LEN to *OP, not going past
+   END.  Returns false if it doesn't fit. */
+static bool
+lz_put_length (uint8_t **op, uint8_t *end, size_t len)
+{
+  for (; len >= 255; len -= 255)
+    {
+      if (*op >= end)
+        return false;
+      *(*op)++ = 255;
+    }
+  if (*op >= end)
+    return false;
+  *(*op)++ = len;
+  return true;
+}
+
+/* Appends a sequence of LIT_CNT literals at LIT and, unless
+   MATCH_LEN is 0, a match of MATCH_LEN bytes at OFFSET back.
+   Returns false if it doesn't fit before END. */
+static bool
+lz_put_sequence (uint8_t **op, uint8_t *end, const uint8_t *lit,
+                 size_t lit_cnt, size_t offset, size_t match_len)
+{
+  size_t ml = match_len > 0 ? match_len - LZ_MIN_MATCH : 0;
+  uint8_t *token = *op;
+
+  if (*op >= end)
+    return false;
+  (*op)++;
+  *token = ((lit_cnt < 15 ? lit_cnt : 15) << 4) | (ml < 15 ? ml : 15);
+  if (lit_cnt >= 15 && !lz_put_length (op, end, lit_cnt - 15))
+    return false;
+  if ((size_t) (end - *op) < lit_cnt)
+    return false;
+  memcpy (*op, lit, lit_cnt);
+  *op += lit_cnt;
+
+  if (match_len == 0)
+    return true;
+  if (end - *op < 2)
+    return false;
+  *(*op)++ = offset;
+  *(*op)++ = offset >> 8;
+  return ml < 15 || lz_put_length (op, end, ml - 15);
+}
+
+/* Compresses the SIZE bytes at SRC into DST, which has room for
+   CAPACITY bytes.  Returns the compressed size, or 0 if it would
+   exceed CAPACITY. */
+static size_t
+lz_compress (const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+{
+  uint8_t *op = dst, *end = dst + capacity;
+  size_t ip = 0, anchor = 0;
+
+  ASSERT (size <= UINT16_MAX);
+
+  memset (lz_table, 0, sizeof lz_table);
+  while (ip + LZ_MIN_MATCH <= size)
+    {
+      uint32_t word = lz_read32 (src + ip);
+      unsigned h = lz_hash (word);
+      size_t ref = lz_table[h];
+
+      lz_table[h] = ip + 1;
+      if (ref != 0 && lz_read32 (src + ref - 1) == word)
+        {
+          size_t len = LZ_MIN_MATCH;
+          ref--;
+          while (ip + len < size && src[ref + len] == src[ip + len])
+            len++;
+          if (!lz_put_sequence (&op, end, src + anchor, ip - anchor,
+                                ip - ref, len))
+            return 0;
+          ip += len;
+          anchor = ip;
+        }
+      else
+        ip++;
+    }
+  if (!lz_put_sequence (&op, end, src + anchor, size - anchor, 0, 0))
+    return 0;
+  return op - dst;
+}
+
+/* Reads a length extension from *IP, not going past END, and
+   adds it to *LEN.  Returns false on a truncated stream. */
+static bool
+lz_get_length (const uint8_t **ip, const uint8_t *end, size_t *len)
+{
+  uint8_t b;
+
+  do
+    {
+      if (*ip >= end)
+        return false;
+      b = *(*ip)++;
+      *len += b;
+    }
+  while (b == 255);
+  return true;
+}
+
+/* Decompresses the SIZE bytes at SRC into DST, which has room
+   for CAPACITY bytes.  Returns the decompressed size, or 0 if
+   the stream is corrupt. */
+static size_t
+lz_decompress (const uint8_t *src, size_t size, uint8_t *dst, size_t capacity)
+{
+  const uint8_t *ip = src, *end = src + size;
+  uint8_t *op = dst, *op_end = dst + capacity;
+
+  while (ip < end)
+    {
+      uint8_t token = *ip++;
+      size_t lit_cnt = token >> 4;
+      size_t match_len = token & 15;
+      size_t offset;
+
+      if (lit_cnt == 15 && !lz_get_length (&ip, end, &lit_cnt))
+        return 0;
+      if ((size_t) (end - ip) < lit_cnt || (size_t) (op_end - op) < lit_cnt)
+        return 0;
+      memcpy (op, ip, lit_cnt);
+      ip += lit_cnt;
+      op += lit_cnt;
+      if (ip == end)
+        break;
+
+      if (end - ip < 2)
+        return 0;
+      offset = ip[0] | (ip[1] << 8);
+      ip += 2;
+      if (match_len == 15 && !lz_get_length (&ip, end, &match_len))
+        return 0;
+      match_len += LZ_MIN_MATCH;
+      if (offset == 0 || offset > (size_t) (op - dst)
+          || (size_t) (op_end - op) < match_len)
+        return 0;
+
+      /* Copy byte by byte: the match may overlap its output. */
+      for (; match_len > 0; match_len--, op++)
+        *op = op[-offset];
+    }
+  return op - dst;
+}
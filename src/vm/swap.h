@@ -0,0 +1,22 @@
+#ifndef VM_SWAP_H
+#define VM_SWAP_H
+
+#include <stdbool.h>
+
+/* A swapped-out page.  Depending on its contents it lives in
+   no storage at all (all zeros), compressed in the RAM pool,
+   or in a page-sized slot on the swap device. */
+struct swap_slot;
+
+/* If true, pages are compressed into a RAM pool before going to
+   the swap device.  Controlled by kernel command-line option
+   "-zswap". */
+extern bool swap_compress;
+
+void swap_init (void);
+struct swap_slot *swap_out (const void *kpage);
+void swap_in (struct swap_slot *, void *kpage);
+void swap_free (struct swap_slot *);
+void swap_print_stats (void);
+
+#endif /* vm/swap.h */